@@ -0,0 +1,333 @@
+/*
+  mi-programoptions
+
+  Copyright (C) 2026 met.no
+
+  Contact information:
+  Norwegian Meteorological Institute
+  Box 43 Blindern
+  0313 OSLO
+  NORWAY
+  email: diana@met.no
+
+  This file is part of mi-programoptions.
+
+  mi-programoptions is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  mi-programoptions is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with mi-programoptions; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "mi_programoptions.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <thread>
+
+using namespace miutil::program_options;
+
+namespace {
+std::atomic<size_t> allocations(0);
+} // namespace
+
+void* operator new(size_t size)
+{
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  std::free(p);
+}
+
+namespace {
+
+struct bench_result
+{
+  std::string name;
+  size_t size;
+  double ns_per_op;
+  double allocs_per_op;
+};
+
+class bench
+{
+public:
+  bench(const std::string& filter, double min_seconds)
+      : filter_(filter)
+      , min_seconds_(min_seconds)
+  {
+  }
+
+  /*!
+   * Run body repeatedly for at least min_seconds.
+   *
+   * \param ops number of operations done by one call of body
+   */
+  void run(const std::string& name, size_t size, size_t ops, const std::function<void()>& body);
+
+  const std::vector<bench_result>& results() const { return results_; }
+
+private:
+  std::string filter_;
+  double min_seconds_;
+  std::vector<bench_result> results_;
+};
+
+void bench::run(const std::string& name, size_t size, size_t ops, const std::function<void()>& body)
+{
+  if (!filter_.empty() && name.find(filter_) == std::string::npos)
+    return;
+
+  typedef std::chrono::steady_clock clock;
+  body(); // warm up
+
+  size_t runs = 0;
+  const size_t allocations_before = allocations.load();
+  const clock::time_point start = clock::now();
+  double seconds = 0;
+  do {
+    body();
+    runs += 1;
+    seconds = std::chrono::duration<double>(clock::now() - start).count();
+  } while (seconds < min_seconds_);
+  const size_t allocations_used = allocations.load() - allocations_before;
+
+  const double total_ops = double(runs) * ops;
+  const bench_result r{name, size, seconds * 1e9 / total_ops, allocations_used / total_ops};
+  results_.push_back(r);
+  std::cout << std::left << std::setw(24) << r.name << std::right << std::setw(10) << r.size << std::fixed << std::setprecision(1) << std::setw(14)
+            << r.ns_per_op << " ns/op" << std::setprecision(3) << std::setw(12) << r.allocs_per_op << " allocs/op" << std::endl;
+}
+
+std::string make_key(size_t i)
+{
+  std::ostringstream k;
+  k << "section" << (i % 16) << ".option" << i;
+  return k.str();
+}
+
+void make_options(size_t count, std::vector<option>& opts, option_set& options)
+{
+  opts.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    std::ostringstream sk;
+    sk << "o" << i;
+    opts.push_back(option(make_key(i), "benchmark option").set_shortkey(sk.str()).set_composing());
+  }
+  for (const option& o : opts)
+    options.add(o);
+}
+
+void bench_command_line(bench& b, size_t max_size)
+{
+  std::vector<option> opts;
+  option_set options;
+  make_options(100, opts, options);
+
+  for (size_t n = 10; n <= max_size && n <= 100000; n *= 10) {
+    std::vector<std::string> args;
+    args.reserve(n + 1);
+    args.push_back("bench.exe");
+    for (size_t i = 1; i <= n; ++i) {
+      if (i % 4 == 0)
+        args.push_back("--" + make_key(i % opts.size()) + "=value");
+      else
+        args.push_back("/some/path/to/input/file" + std::to_string(i) + ".nc");
+    }
+    std::vector<char*> argv;
+    for (std::string& a : args)
+      argv.push_back(&a[0]);
+
+    b.run("parse_command_line", n, n, [&]() {
+      std::vector<std::string> positional;
+      parse_command_line(argv.size(), argv.data(), options, positional);
+    });
+  }
+}
+
+void bench_config_file(bench& b, size_t max_size)
+{
+  std::vector<option> opts;
+  option_set options;
+  make_options(1000, opts, options);
+
+  for (size_t n = 1000; n <= max_size && n <= 1000000; n *= 10) {
+    // blocks of 16 lines with a section header, a comment and 14 values
+    std::ostringstream config;
+    const size_t per_section = opts.size() / 16;
+    for (size_t i = 0; i < n; ++i) {
+      const size_t section = (i / 16) % 16;
+      if (i % 16 == 0)
+        config << "[section" << section << "]\n";
+      else if (i % 16 == 1)
+        config << "# comment line " << i << "\n";
+      else
+        config << "option" << (section + 16 * (i % per_section)) << " = \"value " << i << "\"\n";
+    }
+    const std::string text = config.str();
+    b.run("parse_config_file", n, n, [&]() {
+      std::istringstream in(text);
+      parse_config_file(in, options);
+    });
+    b.run("parse_config_file_mt", n, n, [&]() {
+      std::istringstream in(text);
+      parse_config_file(in, options, config_settings().set_threads(0));
+    });
+  }
+}
+
+void bench_find_option(bench& b, size_t max_size)
+{
+  for (size_t n = 10; n <= max_size && n <= 10000; n *= 10) {
+    std::vector<option> opts;
+    option_set options;
+    make_options(n, opts, options);
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < n; ++i)
+      keys.push_back(make_key(i));
+
+    b.run("find_option", n, n, [&]() {
+      for (const std::string& k : keys)
+        options.find_option(k);
+    });
+  }
+}
+
+void bench_value_set(bench& b, size_t max_size)
+{
+  for (size_t n = 10; n <= max_size && n <= 10000; n *= 10) {
+    std::vector<option> opts;
+    option_set options;
+    make_options(n, opts, options);
+    const std::string value = "value";
+
+    b.run("value_set_put", n, n, [&]() {
+      value_set values;
+      for (const option& o : opts)
+        values.put(&o, value);
+    });
+
+    value_set values;
+    for (const option& o : opts)
+      values.put(&o, value);
+    b.run("value_set_get", n, n, [&]() {
+      size_t found = 0;
+      for (const option& o : opts)
+        found += values.get(o)->size();
+      if (found != n)
+        std::abort();
+    });
+
+    b.run("value_set_add", n, n, [&]() {
+      value_set target;
+      target.add(values);
+    });
+  }
+}
+
+void bench_snapshot_read(bench& b, size_t max_size)
+{
+  std::vector<option> opts;
+  option_set options;
+  make_options(100, opts, options);
+  value_set values;
+  for (size_t i = 0; i < opts.size(); ++i)
+    values.put(&opts[i], std::to_string(i));
+  const atomic_value_snapshot current((value_snapshot(values)));
+
+  // wall time per lookup over all threads, so perfect scaling halves ns/op when doubling threads
+  const size_t lookups = 100000;
+  const auto readers = [&](size_t n, bool load_each) {
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < n; ++t) {
+      threads.push_back(std::thread([&]() {
+        value_snapshot snapshot = current.load();
+        size_t sum = 0;
+        for (size_t i = 0; i < lookups; ++i) {
+          if (load_each)
+            snapshot = current.load();
+          sum += snapshot->values_as<int>(&opts[i % opts.size()]).front();
+        }
+        if (sum == 0)
+          std::abort();
+      }));
+    }
+    for (std::thread& t : threads)
+      t.join();
+  };
+  for (size_t n = 1; n <= max_size && n <= 8; n *= 2) {
+    b.run("snapshot_read", n, n * lookups, [&]() { readers(n, false); });
+    b.run("snapshot_load_read", n, n * lookups, [&]() { readers(n, true); });
+  }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  const option op_help = option("help", "show help").set_shortkey("h").set_narg(0);
+  const option op_output = option("output", "write results as CSV to this file").set_shortkey("o");
+  const option op_filter = option("filter", "only run benchmarks with names containing this").set_shortkey("f");
+  const option op_max_size = option("max-size", "largest input size").set_default_value("1000000");
+  const option op_seconds = option("seconds", "minimum time per benchmark").set_default_value("0.5");
+
+  option_set options;
+  options << op_help << op_output << op_filter << op_max_size << op_seconds;
+
+  try {
+    std::vector<std::string> positional;
+    const value_set values = parse_command_line(argc, argv, options, positional);
+    if (values.is_set(op_help)) {
+      options.help(std::cout);
+      return 0;
+    }
+    if (!positional.empty())
+      throw option_error("unexpected positional argument '" + positional.front() + "'");
+
+    bench b(values.is_set(op_filter) ? values.value(op_filter) : std::string(), values.value_as<double>(op_seconds));
+    const size_t max_size = values.value_as<size_t>(op_max_size);
+    bench_command_line(b, max_size);
+    bench_config_file(b, max_size);
+    bench_find_option(b, max_size);
+    bench_value_set(b, max_size);
+    bench_snapshot_read(b, max_size);
+
+    if (values.is_set(op_output)) {
+      std::ofstream out(values.value(op_output));
+      if (!out)
+        throw option_error("cannot write '" + values.value(op_output) + "'");
+      out << "benchmark,size,ns_per_op,allocs_per_op\n";
+      for (const bench_result& r : b.results())
+        out << r.name << ',' << r.size << ',' << r.ns_per_op << ',' << r.allocs_per_op << '\n';
+    }
+  } catch (option_error& oe) {
+    std::cerr << "error: " << oe.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,288 @@
+/*
+  mi-programoptions
+
+  Copyright (C) 2026 met.no
+
+  Contact information:
+  Norwegian Meteorological Institute
+  Box 43 Blindern
+  0313 OSLO
+  NORWAY
+  email: diana@met.no
+
+  This file is part of mi-programoptions.
+
+  mi-programoptions is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  mi-programoptions is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with mi-programoptions; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "mi_po_cache.h"
+#include "mi_po_mmap.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+// Layout of a value cache file, all numbers in native byte order:
+//
+//   char[8] "MIPOVALC"
+//   u32     0x01020304, to detect byte order
+//   u32     format version
+//   u64     fingerprint of the option_set
+//   u64     size of the source file
+//   i64     modification time of the source file in ns
+//   u64     number of entries
+//   entries:
+//     u32 key length, key
+//     u32 number of values
+//     values: u32 length, value
+
+namespace {
+
+const char MAGIC[8] = {'M', 'I', 'P', 'O', 'V', 'A', 'L', 'C'};
+const uint32_t ORDER_MARK = 0x01020304;
+const uint32_t VERSION = 1;
+
+using namespace miutil::program_options;
+
+void hash_bytes(uint64_t& h, const void* data, size_t size)
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; ++i) {
+    h ^= bytes[i];
+    h *= 1099511628211ull;
+  }
+}
+
+template <class T>
+void hash_value(uint64_t& h, T value)
+{
+  hash_bytes(h, &value, sizeof(value));
+}
+
+void hash_strings(uint64_t& h, const std::vector<std::string>& strings)
+{
+  hash_value(h, uint64_t(strings.size()));
+  for (const std::string& s : strings) {
+    hash_value(h, uint64_t(s.size()));
+    hash_bytes(h, s.data(), s.size());
+  }
+}
+
+//! hash of everything in options that changes how config files are parsed
+uint64_t fingerprint(const option_set& options)
+{
+  uint64_t h = 14695981039346656037ull;
+  hash_value(h, VERSION);
+  for (option_cx opt : options) {
+    hash_strings(h, opt->keys());
+    hash_value(h, uint64_t(opt->narg()));
+    hash_value(h, char(opt->is_composing()));
+    hash_value(h, char(opt->is_overwriting()));
+  }
+  return h;
+}
+
+template <class T>
+void write_value(std::ostream& out, T value)
+{
+  out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void write_string(std::ostream& out, const std::string& s)
+{
+  write_value(out, uint32_t(s.size()));
+  out.write(s.data(), s.size());
+}
+
+//! reads from a memory range, sets ok to false instead of reading beyond the end
+class cache_reader
+{
+public:
+  cache_reader(const char* begin, const char* end)
+      : pos_(begin)
+      , end_(end)
+      , ok_(true)
+  {
+  }
+
+  template <class T>
+  T read()
+  {
+    T value = T();
+    if (available(sizeof(value))) {
+      std::memcpy(&value, pos_, sizeof(value));
+      pos_ += sizeof(value);
+    }
+    return value;
+  }
+
+  bool read_string(std::string& s)
+  {
+    const uint32_t size = read<uint32_t>();
+    if (!available(size))
+      return false;
+    s.assign(pos_, size);
+    pos_ += size;
+    return true;
+  }
+
+  //! \return false if less than count items of at least min_size bytes are left
+  bool has_items(uint64_t count, size_t min_size) const { return ok_ && count <= size_t(end_ - pos_) / min_size; }
+
+  bool ok() const { return ok_; }
+
+private:
+  bool available(size_t size)
+  {
+    ok_ = ok_ && size_t(end_ - pos_) >= size;
+    return ok_;
+  }
+
+private:
+  const char* pos_;
+  const char* end_;
+  bool ok_;
+};
+
+} // namespace
+
+namespace miutil {
+namespace program_options {
+
+void save_value_cache(const std::string& cache_file, const value_set& values, const option_set& options, const std::string& source_file)
+{
+  uint64_t source_size;
+  int64_t source_mtime;
+  if (!detail::file_stamp(source_file, source_size, source_mtime))
+    throw option_error("cannot read size and time of '" + source_file + "'");
+  detail::save_value_cache(cache_file, values, options, source_size, source_mtime);
+}
+
+namespace detail {
+
+void save_value_cache(const std::string& cache_file, const value_set& values, const option_set& options, uint64_t source_size, int64_t source_mtime)
+{
+  uint64_t entries = 0;
+  for (option_cx opt : options) {
+    if (values.is_set(opt))
+      entries += 1;
+  }
+
+  // write to a temporary file and rename, so that readers never see an incomplete file
+  const std::string tmp_file = detail::temporary_filename(cache_file);
+  {
+    std::ofstream out(tmp_file, std::ios::binary | std::ios::trunc);
+    out.write(MAGIC, sizeof(MAGIC));
+    write_value(out, ORDER_MARK);
+    write_value(out, VERSION);
+    write_value(out, fingerprint(options));
+    write_value(out, source_size);
+    write_value(out, source_mtime);
+    write_value(out, entries);
+    for (option_cx opt : options) {
+      if (const string_v* v = values.get(opt)) {
+        write_string(out, opt->key());
+        write_value(out, uint32_t(v->size()));
+        for (const std::string& s : *v)
+          write_string(out, s);
+      }
+    }
+    out.close();
+    if (!out) {
+      std::remove(tmp_file.c_str());
+      throw option_error("cannot write value cache '" + cache_file + "'");
+    }
+  }
+  if (std::rename(tmp_file.c_str(), cache_file.c_str()) != 0) {
+    std::remove(tmp_file.c_str());
+    throw option_error("cannot write value cache '" + cache_file + "'");
+  }
+}
+
+} // namespace detail
+
+bool load_value_cache(const std::string& cache_file, option_set& options, const std::string& source_file, value_set& values)
+{
+  uint64_t source_size;
+  int64_t source_mtime;
+  if (!detail::file_stamp(source_file, source_size, source_mtime))
+    return false;
+
+  detail::mapped_file mapped;
+  std::string buffer;
+  const char *begin, *end;
+  if (mapped.map(cache_file)) {
+    begin = mapped.begin();
+    end = mapped.end();
+  } else {
+    std::ifstream in(cache_file, std::ios::binary);
+    if (!in)
+      return false;
+    buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    begin = buffer.data();
+    end = begin + buffer.size();
+  }
+
+  if (size_t(end - begin) < sizeof(MAGIC) || std::memcmp(begin, MAGIC, sizeof(MAGIC)) != 0)
+    return false;
+  cache_reader reader(begin + sizeof(MAGIC), end);
+  if (reader.read<uint32_t>() != ORDER_MARK || reader.read<uint32_t>() != VERSION || reader.read<uint64_t>() != fingerprint(options) ||
+      reader.read<uint64_t>() != source_size || reader.read<int64_t>() != source_mtime || !reader.ok())
+    return false;
+
+  value_set loaded;
+  std::string key;
+  string_v v;
+  for (uint64_t entries = reader.read<uint64_t>(); reader.ok() && entries > 0; --entries) {
+    if (!reader.read_string(key))
+      return false;
+    // each value has at least its length, do not trust count before resizing
+    const uint32_t count = reader.read<uint32_t>();
+    if (!reader.has_items(count, sizeof(uint32_t)))
+      return false;
+    v.resize(count);
+    for (std::string& s : v) {
+      if (!reader.read_string(s))
+        return false;
+    }
+
+    // a well-formed but inconsistent cache is just invalid, the source is parsed instead
+    try {
+      option_cx opt = options.find_option(key);
+      if (opt->is_composing()) {
+        for (std::string& s : v)
+          loaded.put(opt, std::move(s));
+      } else {
+        // options without args are stored with one empty value
+        if (v.size() != std::max<size_t>(opt->narg(), 1))
+          return false;
+        loaded.put(opt, std::move(v));
+      }
+    } catch (option_error&) {
+      return false;
+    }
+  }
+  if (!reader.ok())
+    return false;
+
+  values.add(std::move(loaded));
+  return true;
+}
+
+} // namespace program_options
+} // namespace miutil
@@ -0,0 +1,54 @@
+/*
+  mi-programoptions
+
+  Copyright (C) 2026 met.no
+
+  Contact information:
+  Norwegian Meteorological Institute
+  Box 43 Blindern
+  0313 OSLO
+  NORWAY
+  email: diana@met.no
+
+  This file is part of mi-programoptions.
+
+  mi-programoptions is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  mi-programoptions is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with mi-programoptions; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef MI_PO_CACHE_H
+#define MI_PO_CACHE_H
+
+// internal header, not installed
+
+#include "mi_programoptions.h"
+
+#include <cstdint>
+#include <string>
+
+namespace miutil {
+namespace program_options {
+namespace detail {
+
+/*!
+ * Like save_value_cache, with the size and modification time of the
+ * source file as read before parsing it.
+ */
+void save_value_cache(const std::string& cache_file, const value_set& values, const option_set& options, uint64_t source_size, int64_t source_mtime);
+
+} // namespace detail
+} // namespace program_options
+} // namespace miutil
+
+#endif // MI_PO_CACHE_H
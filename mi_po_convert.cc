@@ -0,0 +1,209 @@
+/*
+  mi-programoptions
+
+  Copyright (C) 2026 met.no
+
+  Contact information:
+  Norwegian Meteorological Institute
+  Box 43 Blindern
+  0313 OSLO
+  NORWAY
+  email: diana@met.no
+
+  This file is part of mi-programoptions.
+
+  mi-programoptions is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  mi-programoptions is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with mi-programoptions; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "mi_programoptions.h"
+
+#include "mi_po_lexer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <limits>
+#include <type_traits>
+
+#ifdef __GLIBC__
+#include <locale.h>
+#else
+#include <locale>
+#include <sstream>
+#endif
+
+namespace {
+
+using miutil::program_options::detail::is_space;
+
+void trim(const char*& begin, const char*& end)
+{
+  while (begin != end && is_space(*begin))
+    ++begin;
+  while (end != begin && is_space(end[-1]))
+    --end;
+}
+
+template <class T>
+bool convert_integer(const char* begin, const char* end, T& value)
+{
+  typedef typename std::make_unsigned<T>::type U;
+
+  trim(begin, end);
+  const bool negative = (begin != end && *begin == '-');
+  if (negative) {
+    if (!std::numeric_limits<T>::is_signed)
+      return false;
+    ++begin;
+  }
+  if (begin == end)
+    return false;
+
+  const U limit = negative ? U(std::numeric_limits<T>::max()) + 1 : U(std::numeric_limits<T>::max());
+  U v = 0;
+  for (; begin != end; ++begin) {
+    if (*begin < '0' || *begin > '9')
+      return false;
+    const U digit = *begin - '0';
+    if (v > (limit - digit) / 10)
+      return false;
+    v = v * 10 + digit;
+  }
+  value = negative ? T(U(0) - v) : T(v);
+  return true;
+}
+
+template <class T>
+bool convert_floating(const char* begin, const char* end, T& value)
+{
+  trim(begin, end);
+  if (begin == end)
+    return false;
+
+  // decimal numbers only, strtod would also accept inf, nan and hex floats
+  for (const char* c = begin; c != end; ++c) {
+    if (!((*c >= '0' && *c <= '9') || *c == '.' || *c == 'e' || *c == 'E' || *c == '+' || *c == '-'))
+      return false;
+  }
+
+  // strtod needs a nul-terminated string
+  char buffer[64];
+  std::string longer;
+  const char* text = buffer;
+  const size_t length = end - begin;
+  if (length < sizeof(buffer)) {
+    std::copy(begin, end, buffer);
+    buffer[length] = 0;
+  } else {
+    longer.assign(begin, end);
+    text = longer.c_str();
+  }
+
+#ifdef __GLIBC__
+  // strtod_l with the "C" locale does not depend on the global locale
+  static const locale_t c_locale = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+  char* text_end = nullptr;
+  errno = 0;
+  const double v = strtod_l(text, &text_end, c_locale);
+  if (text_end != text + length || errno == ERANGE)
+    return false;
+#else
+  std::istringstream in(text);
+  in.imbue(std::locale::classic());
+  double v;
+  if (!(in >> v) || in.get() != std::char_traits<char>::eof())
+    return false;
+#endif
+  // narrowing an out of range double is undefined
+  if (v > std::numeric_limits<T>::max() || v < -std::numeric_limits<T>::max())
+    return false;
+  value = static_cast<T>(v);
+  return true;
+}
+
+bool equals(const char* begin, const char* end, const char* word)
+{
+  for (; begin != end && *word; ++begin, ++word) {
+    if (*begin != *word)
+      return false;
+  }
+  return begin == end && !*word;
+}
+
+} // namespace
+
+namespace miutil {
+namespace program_options {
+
+bool convert_value(const char* begin, const char* end, int& value)
+{
+  return convert_integer(begin, end, value);
+}
+
+bool convert_value(const char* begin, const char* end, long& value)
+{
+  return convert_integer(begin, end, value);
+}
+
+bool convert_value(const char* begin, const char* end, long long& value)
+{
+  return convert_integer(begin, end, value);
+}
+
+bool convert_value(const char* begin, const char* end, unsigned int& value)
+{
+  return convert_integer(begin, end, value);
+}
+
+bool convert_value(const char* begin, const char* end, unsigned long& value)
+{
+  return convert_integer(begin, end, value);
+}
+
+bool convert_value(const char* begin, const char* end, unsigned long long& value)
+{
+  return convert_integer(begin, end, value);
+}
+
+bool convert_value(const char* begin, const char* end, float& value)
+{
+  return convert_floating(begin, end, value);
+}
+
+bool convert_value(const char* begin, const char* end, double& value)
+{
+  return convert_floating(begin, end, value);
+}
+
+bool convert_value(const char* begin, const char* end, bool& value)
+{
+  trim(begin, end);
+  if (equals(begin, end, "true") || equals(begin, end, "yes") || equals(begin, end, "on") || equals(begin, end, "1"))
+    value = true;
+  else if (equals(begin, end, "false") || equals(begin, end, "no") || equals(begin, end, "off") || equals(begin, end, "0"))
+    value = false;
+  else
+    return false;
+  return true;
+}
+
+bool convert_value(const char* begin, const char* end, std::string& value)
+{
+  value.assign(begin, end);
+  return true;
+}
+
+} // namespace program_options
+} // namespace miutil
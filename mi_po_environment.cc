@@ -0,0 +1,136 @@
+/*
+  mi-programoptions
+
+  Copyright (C) 2026 met.no
+
+  Contact information:
+  Norwegian Meteorological Institute
+  Box 43 Blindern
+  0313 OSLO
+  NORWAY
+  email: diana@met.no
+
+  This file is part of mi-programoptions.
+
+  mi-programoptions is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  mi-programoptions is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with mi-programoptions; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "mi_programoptions.h"
+
+#include "mi_po_lexer.h"
+
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+#if defined(_WIN32)
+#include <stdlib.h>
+#define MI_PO_ENVIRON _environ
+#else
+#include <unistd.h>
+extern char** environ;
+#define MI_PO_ENVIRON environ
+#endif
+
+namespace miutil {
+namespace program_options {
+
+namespace {
+
+void put_environment_value(value_set& values, option_cx opt, const char* begin, const char* end)
+{
+  if (begin == end && opt->has_implicit_value()) {
+    values.put_implicit(opt);
+  } else if (opt->narg() == 0) {
+    // like a flag on the command line, "APP_FLAG=0" must not turn it on
+    if (begin != end)
+      throw option_error("arg for no-arg option '" + opt->key() + "'");
+    values.put(opt, std::string());
+  } else if (opt->narg() == 1 || opt->is_composing()) {
+    values.emplace(opt, begin, end);
+  } else {
+    // several values separated by whitespace
+    string_v args;
+    while (true) {
+      while (begin != end && detail::is_space(*begin))
+        ++begin;
+      if (begin == end)
+        break;
+      const char* word = begin;
+      while (begin != end && !detail::is_space(*begin))
+        ++begin;
+      args.emplace_back(word, begin);
+    }
+    if (args.size() != opt->narg())
+      throw option_error("option '" + opt->key() + "' expects " + std::to_string(opt->narg()) + " values");
+    values.put(opt, std::move(args));
+  }
+}
+
+} // namespace
+
+std::string environment_name(const std::string& key)
+{
+  std::string name(key);
+  for (char& c : name) {
+    if (c >= 'a' && c <= 'z')
+      c = c - 'a' + 'A';
+    else if (c == '.' || c == '-')
+      c = '_';
+  }
+  return name;
+}
+
+value_set parse_environment(option_set& options, const std::string& prefix, environment_mapping mapping)
+{
+  return parse_environment(options, prefix, MI_PO_ENVIRON, mapping);
+}
+
+value_set parse_environment(option_set& options, const std::string& prefix, const char* const* env, environment_mapping mapping)
+{
+  if (!mapping)
+    mapping = environment_name;
+
+  // variable name for each key, the first option with a name wins
+  std::unordered_map<std::string, option_cx> names;
+  for (option_cx opt : options) {
+    for (const std::string& k : opt->keys())
+      names.emplace(prefix + mapping(k), opt);
+  }
+
+  value_set values;
+  std::string name;
+  for (; env && *env; ++env) {
+    const char* var = *env;
+    if (std::strncmp(var, prefix.c_str(), prefix.size()) != 0)
+      continue;
+    const char* eq = std::strchr(var, '=');
+    if (!eq)
+      continue;
+    name.assign(var, eq);
+    const std::unordered_map<std::string, option_cx>::const_iterator it = names.find(name);
+    if (it == names.end())
+      continue;
+    try {
+      put_environment_value(values, it->second, eq + 1, eq + 1 + std::strlen(eq + 1));
+    } catch (option_error& oe) {
+      throw option_error("environment variable '" + name + "': " + oe.what());
+    }
+  }
+  return values;
+}
+
+} // namespace program_options
+} // namespace miutil
@@ -0,0 +1,259 @@
+/*
+  mi-programoptions
+
+  Copyright (C) 2026 met.no
+
+  Contact information:
+  Norwegian Meteorological Institute
+  Box 43 Blindern
+  0313 OSLO
+  NORWAY
+  email: diana@met.no
+
+  This file is part of mi-programoptions.
+
+  mi-programoptions is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  mi-programoptions is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with mi-programoptions; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "mi_po_lexer.h"
+
+#include <cstring>
+#include <istream>
+
+namespace miutil {
+namespace program_options {
+namespace detail {
+
+bool scan_option(const char* begin, const char* end, option_token& token)
+{
+  const char* p = begin;
+  if (p == end || *p != '-')
+    return false;
+  ++p;
+  token.shortkey = (p == end || *p != '-');
+  if (!token.shortkey)
+    ++p;
+
+  if (p == end || !is_option_first_char(*p))
+    return false;
+  token.key_begin = p;
+  while (++p != end && is_option_char(*p))
+    ;
+  token.key_end = p;
+
+  token.has_value = (p != end);
+  if (!token.has_value) {
+    token.value_begin = token.value_end = end;
+    return true;
+  }
+  if (*p != '=')
+    return false;
+  token.value_begin = ++p;
+  for (; p != end; ++p) {
+    if (is_line_break(*p))
+      return false;
+  }
+  token.value_end = end;
+  return true;
+}
+
+namespace {
+const char* skip_space(const char* p, const char* end)
+{
+  while (p != end && is_space(*p))
+    ++p;
+  return p;
+}
+
+const char* skip_key(const char* p, const char* end)
+{
+  if (p == end || !is_option_first_char(*p))
+    return p;
+  while (++p != end && is_option_char(*p))
+    ;
+  return p;
+}
+
+bool has_line_break(const char* p, const char* end)
+{
+  for (; p != end; ++p) {
+    if (is_line_break(*p))
+      return true;
+  }
+  return false;
+}
+} // namespace
+
+line_kind scan_config_line(const char* begin, const char* end, config_line& line)
+{
+  line.kind = LINE_BAD;
+  if (begin == end)
+    return line.kind = LINE_EMPTY;
+
+  if (*begin == '[') {
+    line.key_begin = begin + 1;
+    line.key_end = skip_key(line.key_begin, end);
+    if (line.key_end != line.key_begin && line.key_end + 1 == end && *line.key_end == ']')
+      line.kind = LINE_SECTION;
+    return line.kind;
+  }
+
+  const char* p = skip_space(begin, end);
+  if (p != end && *p == '#') {
+    if (!has_line_break(p + 1, end))
+      line.kind = LINE_COMMENT;
+    return line.kind;
+  }
+
+  line.key_begin = p;
+  line.key_end = p = skip_key(p, end);
+  if (line.key_end == line.key_begin)
+    return line.kind;
+  p = skip_space(p, end);
+  if (p == end || *p != '=')
+    return line.kind;
+  p = skip_space(p + 1, end);
+
+  // the value is everything up to the first line break, only whitespace may follow
+  line.value_begin = p;
+  while (p != end && !is_line_break(*p))
+    ++p;
+  line.value_end = p;
+  if (skip_space(p, end) != end)
+    return line.kind;
+
+  if (line.value_end - line.value_begin >= 2) {
+    const char q = *line.value_begin;
+    if ((q == '\'' || q == '"') && q == line.value_end[-1]) {
+      line.value_begin += 1;
+      line.value_end -= 1;
+    }
+  }
+  return line.kind = LINE_VALUE;
+}
+
+int scan_config_lines(const char* begin, const char* end, std::vector<lexed_line>& lines)
+{
+  int lineno = 0;
+  while (begin != end) {
+    const char* nl = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+    const char* line_end = nl ? nl : end;
+    lexed_line l;
+    l.begin = begin;
+    l.end = line_end;
+    l.lineno = ++lineno;
+    const line_kind kind = scan_config_line(l.begin, l.end, l.line);
+    if (kind != LINE_EMPTY && kind != LINE_COMMENT)
+      lines.push_back(l);
+    begin = nl ? nl + 1 : end;
+  }
+  return lineno;
+}
+
+response_token scan_response_token(const char*& pos, const char* end, const char*& token_begin, const char*& token_end, std::string& unquoted)
+{
+  while (pos != end && is_space(*pos))
+    ++pos;
+  if (pos == end)
+    return RESPONSE_END;
+
+  // most tokens have no quotes or escapes
+  const char* start = pos;
+  while (pos != end && !is_space(*pos) && *pos != '\'' && *pos != '"' && *pos != '\\')
+    ++pos;
+  if (pos == end || is_space(*pos)) {
+    token_begin = start;
+    token_end = pos;
+    return RESPONSE_TOKEN;
+  }
+
+  unquoted.assign(start, pos);
+  char quote = 0;
+  for (; pos != end && (quote || !is_space(*pos)); ++pos) {
+    const char c = *pos;
+    if (quote == '\'') {
+      if (c == quote)
+        quote = 0;
+      else
+        unquoted += c;
+    } else if (c == '\\') {
+      if (++pos == end)
+        return RESPONSE_BAD;
+      unquoted += *pos;
+    } else if (quote == '"' && c == quote) {
+      quote = 0;
+    } else if (!quote && (c == '\'' || c == '"')) {
+      quote = c;
+    } else {
+      unquoted += c;
+    }
+  }
+  if (quote)
+    return RESPONSE_BAD;
+  token_begin = unquoted.data();
+  token_end = unquoted.data() + unquoted.size();
+  return RESPONSE_UNQUOTED;
+}
+
+line_reader::line_reader(std::istream& in)
+    : in_(in)
+    , buffer_(64 * 1024)
+    , pos_(0)
+    , fill_(0)
+    , eof_(false)
+    , newline_(false)
+{
+}
+
+bool line_reader::next(const char*& begin, const char*& end)
+{
+  size_t scan = pos_;
+  while (true) {
+    const char* data = buffer_.data();
+    if (const char* nl = static_cast<const char*>(std::memchr(data + scan, '\n', fill_ - scan))) {
+      begin = data + pos_;
+      end = nl;
+      pos_ = nl - data + 1;
+      newline_ = true;
+      return true;
+    }
+    if (eof_) {
+      if (pos_ == fill_)
+        return false;
+      begin = data + pos_;
+      end = data + fill_;
+      pos_ = fill_;
+      newline_ = false;
+      return true;
+    }
+
+    // no complete line in the buffer, move the incomplete line to the front and read more
+    if (pos_ > 0) {
+      std::memmove(buffer_.data(), data + pos_, fill_ - pos_);
+      fill_ -= pos_;
+      pos_ = 0;
+    } else if (fill_ == buffer_.size()) {
+      buffer_.resize(2 * buffer_.size());
+    }
+    scan = fill_;
+    in_.read(buffer_.data() + fill_, buffer_.size() - fill_);
+    fill_ += in_.gcount();
+    eof_ = !in_;
+  }
+}
+
+} // namespace detail
+} // namespace program_options
+} // namespace miutil
@@ -0,0 +1,171 @@
+/*
+  mi-programoptions
+
+  Copyright (C) 2026 met.no
+
+  Contact information:
+  Norwegian Meteorological Institute
+  Box 43 Blindern
+  0313 OSLO
+  NORWAY
+  email: diana@met.no
+
+  This file is part of mi-programoptions.
+
+  mi-programoptions is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  mi-programoptions is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with mi-programoptions; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef MI_PO_LEXER_H
+#define MI_PO_LEXER_H
+
+// internal header, not installed
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace miutil {
+namespace program_options {
+namespace detail {
+
+//! first character of an option key, regex "[a-zA-Z0-9._]"
+inline bool is_option_first_char(char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '.' || c == '_';
+}
+
+//! following characters of an option key, regex "[a-zA-Z0-9._-]"
+inline bool is_option_char(char c)
+{
+  return is_option_first_char(c) || c == '-';
+}
+
+//! characters matched by regex "\s"
+inline bool is_space(char c)
+{
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+//! characters not matched by regex "."
+inline bool is_line_break(char c)
+{
+  return c == '\n' || c == '\r';
+}
+
+//! command line argument split into key and value
+struct option_token
+{
+  const char* key_begin;
+  const char* key_end;
+  bool shortkey;  //!< true if the key was preceded by a single '-'
+  bool has_value; //!< true if the key was followed by '='
+  const char* value_begin;
+  const char* value_end;
+};
+
+/*!
+ * Split a command line argument like "-k", "--key" or "--key=value".
+ *
+ * Accepts exactly the same arguments as the regex
+ * "(-{1,2})([a-zA-Z0-9._][a-zA-Z0-9._-]*)(=(.*))?".
+ *
+ * \return false if the argument is not an option
+ */
+bool scan_option(const char* begin, const char* end, option_token& token);
+
+enum line_kind { LINE_EMPTY, LINE_COMMENT, LINE_SECTION, LINE_VALUE, LINE_BAD };
+
+//! config file line split into key and value
+struct config_line
+{
+  line_kind kind;
+  const char* key_begin; //!< section name for LINE_SECTION
+  const char* key_end;
+  const char* value_begin; //!< without surrounding whitespace and quotes
+  const char* value_end;
+};
+
+/*!
+ * Classify a config file line (without the line end).
+ *
+ * Accepts exactly the same lines as the regexes "\s*#.*" (comment),
+ * "\[([a-zA-Z0-9._][a-zA-Z0-9._-]*)\]$" (section) and
+ * "\s*([a-zA-Z0-9._][a-zA-Z0-9._-]*)\s*=\s*(.*)?\s*" (value). Values
+ * quoted with matching ' or " are unquoted.
+ */
+line_kind scan_config_line(const char* begin, const char* end, config_line& line);
+
+//! a line from scan_config_lines
+struct lexed_line
+{
+  const char* begin; //!< the whole line, for error messages
+  const char* end;
+  int lineno; //!< counted from 1 within the scanned range
+  config_line line;
+};
+
+/*!
+ * Split [begin, end) into lines like line_reader and classify them.
+ *
+ * Empty and comment lines are not added to lines.
+ *
+ * \return the number of lines in [begin, end)
+ */
+int scan_config_lines(const char* begin, const char* end, std::vector<lexed_line>& lines);
+
+enum response_token {
+  RESPONSE_END,      //!< no more tokens
+  RESPONSE_TOKEN,    //!< token points into the input
+  RESPONSE_UNQUOTED, //!< token points into unquoted
+  RESPONSE_BAD       //!< unterminated quote or escape
+};
+
+/*!
+ * Scan the next whitespace separated token of a response file from pos.
+ *
+ * Text in '...' is literal, in "..." backslash escapes the next
+ * character, as it does outside quotes.
+ */
+response_token scan_response_token(const char*& pos, const char* end, const char*& token_begin, const char*& token_end, std::string& unquoted);
+
+/*!
+ * Reads lines from a stream in large blocks, like std::getline.
+ *
+ * The line returned by next() is valid until the next call.
+ */
+class line_reader
+{
+public:
+  explicit line_reader(std::istream& in);
+
+  bool next(const char*& begin, const char*& end);
+
+  //! true if the line returned by next() ended with a newline, false for an unterminated last line
+  bool newline() const { return newline_; }
+
+private:
+  std::istream& in_;
+  std::vector<char> buffer_;
+  size_t pos_;
+  size_t fill_;
+  bool eof_;
+  bool newline_;
+};
+
+} // namespace detail
+} // namespace program_options
+} // namespace miutil
+
+#endif // MI_PO_LEXER_H
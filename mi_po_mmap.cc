@@ -0,0 +1,147 @@
+/*
+  mi-programoptions
+
+  Copyright (C) 2026 met.no
+
+  Contact information:
+  Norwegian Meteorological Institute
+  Box 43 Blindern
+  0313 OSLO
+  NORWAY
+  email: diana@met.no
+
+  This file is part of mi-programoptions.
+
+  mi-programoptions is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  mi-programoptions is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with mi-programoptions; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "mi_po_mmap.h"
+
+#include <atomic>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MI_PO_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <thread>
+#endif
+
+namespace {
+//! distinguishes temporary files of threads in one process
+std::atomic<unsigned long> temporary_counter(0);
+} // namespace
+
+namespace miutil {
+namespace program_options {
+namespace detail {
+
+mapped_file::mapped_file()
+    : data_(nullptr)
+    , size_(0)
+{
+}
+
+mapped_file::~mapped_file()
+{
+  unmap();
+}
+
+#ifdef MI_PO_HAVE_MMAP
+
+bool mapped_file::map(const std::string& filename)
+{
+  unmap();
+
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  // files in /proc etc report size 0, read them as a stream
+  struct stat st;
+  bool ok = (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0);
+  if (ok) {
+    void* data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ok = (data != MAP_FAILED);
+    if (ok) {
+      ::madvise(data, st.st_size, MADV_SEQUENTIAL);
+      data_ = static_cast<const char*>(data);
+      size_ = st.st_size;
+    }
+  }
+  ::close(fd);
+  return ok;
+}
+
+void mapped_file::unmap()
+{
+  if (data_)
+    ::munmap(const_cast<char*>(data_), size_);
+  data_ = nullptr;
+  size_ = 0;
+}
+
+bool file_stamp(const std::string& filename, uint64_t& size, int64_t& mtime_ns)
+{
+  struct stat st;
+  if (::stat(filename.c_str(), &st) != 0)
+    return false;
+  size = st.st_size;
+#if defined(__APPLE__)
+  mtime_ns = int64_t(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+  mtime_ns = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+  return true;
+}
+
+std::string temporary_filename(const std::string& filename)
+{
+  return filename + ".tmp" + std::to_string(::getpid()) + "." + std::to_string(++temporary_counter);
+}
+
+#else // !MI_PO_HAVE_MMAP
+
+bool mapped_file::map(const std::string&)
+{
+  return false;
+}
+
+void mapped_file::unmap() {}
+
+bool file_stamp(const std::string& filename, uint64_t& size, int64_t& mtime_ns)
+{
+  // without stat, only the size can be checked
+  std::ifstream in(filename, std::ios::binary | std::ios::ate);
+  if (!in)
+    return false;
+  size = in.tellg();
+  mtime_ns = 0;
+  return true;
+}
+
+std::string temporary_filename(const std::string& filename)
+{
+  return filename + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + "." + std::to_string(++temporary_counter);
+}
+
+#endif // !MI_PO_HAVE_MMAP
+
+} // namespace detail
+} // namespace program_options
+} // namespace miutil
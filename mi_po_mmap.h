@@ -0,0 +1,85 @@
+/*
+  mi-programoptions
+
+  Copyright (C) 2026 met.no
+
+  Contact information:
+  Norwegian Meteorological Institute
+  Box 43 Blindern
+  0313 OSLO
+  NORWAY
+  email: diana@met.no
+
+  This file is part of mi-programoptions.
+
+  mi-programoptions is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  mi-programoptions is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with mi-programoptions; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef MI_PO_MMAP_H
+#define MI_PO_MMAP_H
+
+// internal header, not installed
+
+#include <cstdint>
+#include <string>
+
+namespace miutil {
+namespace program_options {
+namespace detail {
+
+/*!
+ * Read-only memory map of a whole regular file.
+ *
+ * The file must not be truncated while it is mapped.
+ */
+class mapped_file
+{
+public:
+  mapped_file();
+  ~mapped_file();
+
+  /*!
+   * Map a file.
+   *
+   * \return false if the file cannot be mapped, e.g. because it is a
+   *         pipe, empty, or memory mapping is not supported
+   */
+  bool map(const std::string& filename);
+
+  const char* begin() const { return data_; }
+  const char* end() const { return data_ + size_; }
+
+private:
+  mapped_file(const mapped_file&);
+  mapped_file& operator=(const mapped_file&);
+
+  void unmap();
+
+private:
+  const char* data_;
+  size_t size_;
+};
+
+//! \return false if the size and modification time of filename cannot be read
+bool file_stamp(const std::string& filename, uint64_t& size, int64_t& mtime_ns);
+
+//! \return a file name for writing before renaming to filename, unique per process and call
+std::string temporary_filename(const std::string& filename);
+
+} // namespace detail
+} // namespace program_options
+} // namespace miutil
+
+#endif // MI_PO_MMAP_H
@@ -29,6 +29,8 @@
 
 #include "mi_programoptions.h"
 
+#include <algorithm>
+
 namespace {
 const std::string EMPTY;
 }
@@ -36,171 +38,229 @@ const std::string EMPTY;
 namespace miutil {
 namespace program_options {
 
-struct option::d
+/*!
+ * Texts of an option, shared by its copies.
+ *
+ * The block itself is one allocation together with its shared_ptr
+ * control block, but the key vectors and longer strings allocate their
+ * own storage. edit() copies the block if it is shared, and changes it in
+ * place otherwise, so it is copy-on-write rather than immutable.
+ */
+struct option::text
 {
   std::vector<std::string> keys_;
   std::vector<std::string> shortkeys_;
   std::string help_;
-  size_t narg_;
-  bool is_composing_;
-  bool is_overwriting_;
   std::string default_;
-  bool has_default_;
   std::string implicit_;
-  bool has_implicit_;
+
+  //! "--key / -s" for help and dump
+  std::string key_line_;
+  void render_key_line();
 };
 
-option::option(const std::string& key, const std::string& help)
-    : d_(new d)
+void option::text::render_key_line()
 {
-  d_->help_ = help;
-  d_->narg_ = 1;
-  d_->is_composing_ = false;
-  d_->is_overwriting_ = false;
-  d_->has_default_ = false;
-  d_->has_implicit_ = false;
+  key_line_.clear();
+  for (const auto& k : keys_) {
+    if (!key_line_.empty())
+      key_line_ += " / ";
+    key_line_ += "--";
+    key_line_ += k;
+  }
+  for (const auto& sk : shortkeys_) {
+    if (!key_line_.empty())
+      key_line_ += " / ";
+    key_line_ += "-";
+    key_line_ += sk;
+  }
+}
+
+const size_t option::NO_ORDINAL;
 
+option::option(const std::string& key, const std::string& help)
+    : text_(std::make_shared<text>())
+    , narg_(1)
+    , ordinal_(NO_ORDINAL)
+    , flags_(0)
+{
+  text_->help_ = help;
   add_key(key);
 }
 
 option::option(const option& o)
-    : d_(new d(*o.d_))
+    : text_(o.text_)
+    , narg_(o.narg_)
+    , ordinal_(NO_ORDINAL) // a copy is a different option
+    , flags_(o.flags_)
 {
 }
 
 option::option(option&& o)
-  : d_(std::move(o.d_))
+    : text_(std::move(o.text_))
+    , narg_(o.narg_)
+    , ordinal_(o.ordinal_)
+    , flags_(o.flags_)
 {
 }
 
 option& option::operator=(const option& o)
 {
-  if (this != &o)
-    d_.reset(new d(*o.d_));
+  // keep the ordinal, this is still the same option
+  text_ = o.text_;
+  narg_ = o.narg_;
+  flags_ = o.flags_;
   return *this;
 }
 
 option::~option() {}
 
+option::text& option::edit()
+{
+  if (text_.use_count() > 1)
+    text_ = std::make_shared<text>(*text_);
+  return *text_;
+}
+
 option& option::add_key(const std::string& k)
 {
-  if (!k.empty())
-    d_->keys_.push_back(k);
+  if (!k.empty()) {
+    text& t = edit();
+    t.keys_.push_back(k);
+    t.render_key_line();
+  }
   return *this;
 }
 
 const std::string& option::key() const
 {
-  return d_->keys_.empty() ? EMPTY : d_->keys_.front();
+  return text_->keys_.empty() ? EMPTY : text_->keys_.front();
 }
 
 const std::vector<std::string>& option::keys() const
 {
-  return d_->keys_;
+  return text_->keys_;
+}
+
+const std::string& option::key_line() const
+{
+  return text_->key_line_;
 }
 
 const std::string& option::help() const
 {
-  return d_->help_;
+  return text_->help_;
 }
 
 option& option::set_shortkey(const std::string& sk)
 {
-  d_->shortkeys_.clear();
+  text& t = edit();
+  t.shortkeys_.clear();
+  t.render_key_line();
   return add_shortkey(sk);
 }
 
 option& option::add_shortkey(const std::string& sk)
 {
-  if (!sk.empty())
-    d_->shortkeys_.push_back(sk);
+  if (!sk.empty()) {
+    text& t = edit();
+    t.shortkeys_.push_back(sk);
+    t.render_key_line();
+  }
   return *this;
 }
 
 const std::string& option::shortkey() const
 {
-  return d_->shortkeys_.empty() ? EMPTY : d_->shortkeys_.front();
+  return text_->shortkeys_.empty() ? EMPTY : text_->shortkeys_.front();
 }
 
 const std::vector<std::string>& option::shortkeys() const
 {
-  return d_->shortkeys_;
+  return text_->shortkeys_;
 }
 
 bool option::match(const std::string& key, bool use_shortkeys) const
 {
-  const std::vector<std::string>& k = use_shortkeys ? d_->shortkeys_ : d_->keys_;
+  const std::vector<std::string>& k = use_shortkeys ? text_->shortkeys_ : text_->keys_;
   return std::find(k.begin(), k.end(), key) != k.end();
 }
 
 option& option::set_default_value(const std::string& d)
 {
-  d_->has_default_ = true;
-  d_->default_ = d;
+  flags_ |= HAS_DEFAULT;
+  edit().default_ = d;
   return *this;
 }
 
 bool option::has_default_value() const
 {
-  return d_->has_default_;
+  return flags_ & HAS_DEFAULT;
 }
 
 const std::string& option::default_value() const
 {
-  return d_->default_;
+  return text_->default_;
 }
 
 option& option::set_implicit_value(const std::string& i)
 {
-  d_->has_implicit_ = true;
-  d_->implicit_ = i;
+  flags_ |= HAS_IMPLICIT;
+  edit().implicit_ = i;
   return *this;
 }
 
 bool option::has_implicit_value() const
 {
-  return d_->has_implicit_;
+  return flags_ & HAS_IMPLICIT;
 }
 
 const std::string& option::implicit_value() const
 {
-  return d_->implicit_;
+  return text_->implicit_;
 }
 
 option& option::set_composing()
-
 {
-  d_->is_composing_ = true;
-  d_->is_overwriting_ = false;
+  flags_ = (flags_ & ~OVERWRITING) | COMPOSING;
   return *this;
 }
 
 bool option::is_composing() const
 {
-  return d_->is_composing_;
+  return flags_ & COMPOSING;
 }
 
 option& option::set_overwriting()
 {
-  d_->is_composing_ = false;
-  d_->is_overwriting_ = true;
+  flags_ = (flags_ & ~COMPOSING) | OVERWRITING;
   return *this;
 }
 
 bool option::is_overwriting() const
 {
-  return d_->is_overwriting_;
+  return flags_ & OVERWRITING;
 }
 
 option& option::set_narg(size_t n)
 {
-  d_->narg_ = n;
+  narg_ = n;
   return *this;
 }
 
 size_t option::narg() const
 {
-  return d_->narg_;
+  return narg_;
+}
+
+size_t option::ordinal() const
+{
+  return ordinal_;
+}
+
+void option::set_ordinal(size_t ordinal) const
+{
+  ordinal_ = ordinal;
 }
 
 } // namespace program_options
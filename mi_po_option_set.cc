@@ -29,61 +29,260 @@
 
 #include "mi_programoptions.h"
 
+#include <algorithm>
+#include <cstdlib>
 #include <ostream>
 
-namespace {
-void show_key(std::ostream& out, miutil::program_options::option_cx opt)
-{
-  bool first = true;
-  const std::string sep = " / ";
-  for (const auto& k : opt->keys()) {
-    if (!first)
-      out << sep;
-    out << "--" << k;
-    first = false;
-  }
-  for (const auto& sk : opt->shortkeys()) {
-    if (!first)
-      out << sep;
-    out << "-" << sk;
-    first = false;
-  }
-}
-} // namespace
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
 
 namespace miutil {
 namespace program_options {
 
+option_index::~option_index() {}
+
+parse_stats::parse_stats()
+    : lines(0)
+    , arguments(0)
+    , bytes(0)
+    , values(0)
+    , lookups(0)
+    , lookup_misses(0)
+    , read_ns(0)
+    , config_ns(0)
+    , command_line_ns(0)
+{
+}
+
+option_set::option_set()
+    : external_index_(nullptr)
+    , indexed_(false)
+    , sorted_(false)
+    , stats_(nullptr)
+    , response_files_(false)
+{
+}
+
+option_set& option_set::set_index(const option_index* index)
+{
+  external_index_ = index;
+  return *this;
+}
+
+option_set& option_set::add(const option& option)
+{
+  if (option.ordinal() == option::NO_ORDINAL)
+    option.set_ordinal(options_.size());
+  options_.push_back(&option);
+  sorted_ = false;
+  if (indexed_)
+    index_option(&option);
+  return *this;
+}
+
+void option_set::index_option(option_cx opt)
+{
+  // emplace does not replace, so the first option with a key wins, as in the linear search
+  for (const auto& k : opt->keys())
+    keys_.emplace(k, opt);
+  for (const auto& sk : opt->shortkeys())
+    shortkeys_.emplace(sk, opt);
+}
+
+void option_set::freeze()
+{
+  keys_.clear();
+  shortkeys_.clear();
+  keys_.reserve(options_.size());
+  for (option_cx opt : options_)
+    index_option(opt);
+  indexed_ = true;
+}
+
+std::pair<option_set::keyed_iterator, option_set::keyed_iterator> option_set::find_prefix(const std::string& prefix)
+{
+  if (!sorted_) {
+    sorted_keys_.clear();
+    for (option_cx opt : options_) {
+      for (const auto& k : opt->keys())
+        sorted_keys_.push_back(keyed_option(k, opt));
+    }
+    // stable, so the first option with a key comes first, as in find_option
+    std::stable_sort(sorted_keys_.begin(), sorted_keys_.end(), [](const keyed_option& a, const keyed_option& b) { return a.first < b.first; });
+    sorted_ = true;
+  }
+
+  const keyed_iterator first = std::lower_bound(sorted_keys_.begin(), sorted_keys_.end(), prefix,
+                                                [](const keyed_option& k, const std::string& p) { return k.first < p; });
+  const keyed_iterator last =
+      std::partition_point(first, sorted_keys_.cend(), [&prefix](const keyed_option& k) { return k.first.compare(0, prefix.size(), prefix) == 0; });
+  return std::make_pair(first, last);
+}
+
 option_cx option_set::find_option(const std::string& key, bool use_shortkey)
 {
+  if (stats_)
+    stats_->lookups += 1;
+
+  if (external_index_) {
+    if (option_cx opt = external_index_->find(key, use_shortkey))
+      return opt;
+  }
+
+  if (!indexed_)
+    freeze();
+
+  const key_index_t& index = use_shortkey ? shortkeys_ : keys_;
+  const key_index_t::const_iterator it = index.find(key);
+  if (it != index.end() && it->second->match(key, use_shortkey))
+    return it->second;
+
+  if (stats_)
+    stats_->lookup_misses += 1;
+
+  // keys may have been changed after indexing, find them without the index; this may
+  // miss an earlier option with the same key, which is only found after freeze()
   for (option_cx opt : options_) {
-    if (opt->match(key, use_shortkey))
+    if (opt->match(key, use_shortkey)) {
+      indexed_ = false;
       return opt;
+    }
   }
   throw option_error("no such option '" + key + "'");
 }
 
+// help and dump are rendered into one buffer and written at once, without flushing
+
 void option_set::dump(std::ostream& out, const value_set& values) const
 {
+  std::string buffer;
   for (option_cx opt : options_) {
-    if (values.is_set(opt)) {
-      show_key(out, opt);
-      out << std::endl;
-      for (const std::string& v : *values.get(opt))
-        out << "  => '" << v << "'" << std::endl;
+    if (const string_v* v = values.get(opt)) {
+      buffer += opt->key_line();
+      buffer += '\n';
+      for (const std::string& s : *v) {
+        buffer += "  => '";
+        buffer += s;
+        buffer += "'\n";
+      }
     }
   }
+  out.write(buffer.data(), buffer.size());
 }
 
 void option_set::help(std::ostream& out) const
 {
+  size_t size = 0;
+  for (option_cx opt : options_)
+    size += opt->key_line().size() + opt->help().size() + opt->default_value().size() + 16;
+
+  std::string buffer;
+  buffer.reserve(size);
+  for (option_cx opt : options_) {
+    buffer += opt->key_line();
+    buffer += ": ";
+    buffer += opt->help();
+    if (opt->has_default_value()) {
+      buffer += " (default: ";
+      buffer += opt->default_value();
+      buffer += ')';
+    }
+    buffer += '\n';
+  }
+  out.write(buffer.data(), buffer.size());
+}
+
+void option_set::help(std::ostream& out, size_t width) const
+{
+  const size_t INDENT = 2, GAP = 2, MIN_TEXT = 20;
+
+  // the key column is as wide as the widest key line up to half the width, longer ones get their own line
+  size_t column = 0, size = 0;
   for (option_cx opt : options_) {
-    show_key(out, opt);
-    out << ": " << opt->help();
-    if (opt->has_default_value())
-      out << " (default: " << opt->default_value() << ")";
-    out << std::endl;
+    const size_t k = opt->key_line().size();
+    if (k <= width / 2)
+      column = std::max(column, k);
+    size += width + opt->help().size() + opt->default_value().size();
   }
+  const size_t text_column = INDENT + column + GAP;
+  const size_t text_width = (width > text_column + MIN_TEXT) ? width - text_column : MIN_TEXT;
+
+  std::string buffer, text;
+  buffer.reserve(size);
+  for (option_cx opt : options_) {
+    const std::string& key_line = opt->key_line();
+    buffer.append(INDENT, ' ');
+    buffer += key_line;
+
+    text = opt->help();
+    if (opt->has_default_value()) {
+      text += " (default: ";
+      text += opt->default_value();
+      text += ')';
+    }
+    if (!text.empty()) {
+      if (key_line.size() > column) {
+        buffer += '\n';
+        buffer.append(text_column, ' ');
+      } else {
+        buffer.append(column - key_line.size() + GAP, ' ');
+      }
+
+      // wrap at spaces, or inside words longer than a line
+      size_t pos = 0;
+      while (text.size() - pos > text_width) {
+        size_t brk = text.rfind(' ', pos + text_width);
+        if (brk == std::string::npos || brk <= pos)
+          brk = pos + text_width;
+        buffer.append(text, pos, brk - pos);
+        buffer += '\n';
+        buffer.append(text_column, ' ');
+        pos = text.find_first_not_of(' ', brk);
+        if (pos == std::string::npos)
+          pos = text.size();
+      }
+      buffer.append(text, pos, std::string::npos);
+    }
+    buffer += '\n';
+  }
+  out.write(buffer.data(), buffer.size());
+}
+
+size_t terminal_width()
+{
+#if defined(__unix__) || defined(__APPLE__)
+  struct winsize ws;
+  if (::isatty(STDOUT_FILENO) && ::ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0)
+    return ws.ws_col;
+#endif
+  if (const char* columns = std::getenv("COLUMNS")) {
+    size_t width;
+    if (convert_value(columns, columns + std::char_traits<char>::length(columns), width) && width > 0)
+      return width;
+  }
+  return 80;
+}
+
+option_set& option_set::set_stats(parse_stats* stats)
+{
+  stats_ = stats;
+  return *this;
+}
+
+void option_set::dump_stats(std::ostream& out) const
+{
+  if (!stats_)
+    return;
+  out << "lines: " << stats_->lines << '\n'
+      << "arguments: " << stats_->arguments << '\n'
+      << "bytes: " << stats_->bytes << '\n'
+      << "values: " << stats_->values << '\n'
+      << "lookups: " << stats_->lookups << " (" << stats_->lookup_misses << " misses)\n"
+      << "read: " << stats_->read_ns << " ns\n"
+      << "config: " << stats_->config_ns << " ns\n"
+      << "command line: " << stats_->command_line_ns << " ns\n";
 }
 
 } // namespace program_options
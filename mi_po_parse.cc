@@ -29,7 +29,26 @@
 
 #include "mi_programoptions.h"
 
+#include "mi_po_cache.h"
+#include "mi_po_lexer.h"
+#include "mi_po_mmap.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
 #include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <utility>
 
 namespace {
 const std::string EMPTY;
@@ -38,78 +57,629 @@ const std::string EMPTY;
 namespace miutil {
 namespace program_options {
 
-value_set parse_config_file(const std::string& filename, option_set& options)
+namespace {
+
+//! parser output into a value_set
+struct value_set_target
 {
-  std::ifstream infile(filename);
-  if (!infile)
-    throw option_error("cannot read config file '" + filename + "'");
+  value_set& values;
 
-  try {
-    return parse_config_file(infile, options);
-  } catch (option_error& oe) {
-    throw option_error("while reading '" + filename + ": " + oe.what());
+  //! config file line or argv index of the following values, not needed here
+  void at(int) {}
+  void put_implicit(option_cx opt) { values.put_implicit(opt); }
+  void put(option_cx opt, const char* begin, const char* end) { values.emplace(opt, begin, end); }
+  void put(option_cx opt, const value_range* v, size_t count)
+  {
+    string_v args;
+    args.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+      args.emplace_back(v[i].begin, v[i].end);
+    values.put(opt, std::move(args));
   }
+};
+
+std::string make_string(const char* begin, const char* end)
+{
+  return std::string(begin, end);
 }
 
-#define OPTION_CHARS "[a-zA-Z0-9._][a-zA-Z0-9._-]*"
+const char* make_c_string(const char* begin, const char*)
+{
+  return begin;
+}
 
-value_set parse_config_file(std::istream& infile, option_set& options)
+//! parser output into a value_set and a vector of positional arguments
+template <class Positional, class Make>
+struct value_set_positional_target : value_set_target
 {
-  value_set values;
-  static const std::regex re_comment("\\s*#.*");
-  static const std::regex re_section("\\[(" OPTION_CHARS ")\\]$");
-  enum { GS_ALL, GS_KEY };
-  static const std::regex re_value("\\s*(" OPTION_CHARS ")\\s*=\\s*(.*)?\\s*");
-  enum { GV_ALL, GV_KEY, GV_VALUE };
-  std::string line;
-  std::string section;
-  for (int lineno = 1; std::getline(infile, line); ++lineno) {
-    if (line.empty())
-      continue;
-    std::smatch match;
-    if (std::regex_match(line, match, re_comment)) {
-      // ignore
-    } else if (std::regex_match(line, match, re_section)) {
-      section = match[GS_KEY].str() + ".";
-    } else if (std::regex_match(line, match, re_value)) {
-      std::string value = match[GV_VALUE].str();
-      if (value.size() >= 2 && (value[0] == '\'' || value[0] == '"') && value[0] == value[value.size() - 1])
-        value = value.substr(1, value.size() - 2);
-      try {
-        values.put(options.find_option(section + match[GV_KEY].str(), false), value);
-      } catch (option_error& oe) {
-        std::ostringstream msg;
-        msg << "lineno " << line << ": " << oe.what();
-        throw option_error(msg.str());
-      }
-    } else {
+  value_set_positional_target(value_set& v, std::vector<Positional>& p, Make m)
+      : value_set_target{v}
+      , positional(p)
+      , make_positional(m)
+  {
+  }
+
+  std::vector<Positional>& positional;
+  Make make_positional;
+
+  void put_positional(const char* begin, const char* end) { positional.push_back(make_positional(begin, end)); }
+};
+
+template <class Positional, class Make>
+value_set_positional_target<Positional, Make> make_target(value_set& values, std::vector<Positional>& positional, Make make_positional)
+{
+  return value_set_positional_target<Positional, Make>(values, positional, make_positional);
+}
+
+//! parser output into a value_set and a positional_sink
+struct value_set_sink_target : value_set_target
+{
+  value_set_sink_target(value_set& v, positional_sink& p)
+      : value_set_target{v}
+      , positional(p)
+  {
+  }
+
+  positional_sink& positional;
+
+  void put_positional(const char* begin, const char* end) { positional.put_positional(std::string(begin, end)); }
+};
+
+//! parser output into a value_receiver
+struct receiver_target
+{
+  value_receiver& values;
+
+  void at(int) {}
+  void put_implicit(option_cx opt) { values.put_implicit(opt); }
+  void put(option_cx opt, const char* begin, const char* end)
+  {
+    const value_range v = {begin, end};
+    values.put(opt, &v, 1);
+  }
+  void put(option_cx opt, const value_range* v, size_t count) { values.put(opt, v, count); }
+  void put_positional(const char* begin, const char* end)
+  {
+    const value_range v = {begin, end};
+    values.put_positional(v);
+  }
+};
+
+//! parser output into an option_visitor
+struct visitor_target
+{
+  option_visitor& visitor;
+  source_location where;
+
+  void at(int position) { where.position = position; }
+  void put_implicit(option_cx opt)
+  {
+    const value_range v = {opt->implicit_value().data(), opt->implicit_value().data() + opt->implicit_value().size()};
+    visitor.visit(opt, &v, 1, where);
+  }
+  void put(option_cx opt, const char* begin, const char* end)
+  {
+    const value_range v = {begin, end};
+    visitor.visit(opt, &v, 1, where);
+  }
+  void put(option_cx opt, const value_range* v, size_t count) { visitor.visit(opt, v, count, where); }
+  void put_positional(const char* begin, const char* end)
+  {
+    const value_range v = {begin, end};
+    visitor.visit_positional(v, where);
+  }
+};
+
+//! adds the elapsed wall time to a parse_stats member, if stats are enabled
+class stats_timer
+{
+public:
+  typedef std::chrono::steady_clock clock;
+
+  stats_timer(parse_stats* stats, uint64_t parse_stats::*counter)
+      : counter_(stats ? &(stats->*counter) : nullptr)
+  {
+    if (counter_)
+      start_ = clock::now();
+  }
+
+  ~stats_timer()
+  {
+    if (counter_)
+      *counter_ += std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start_).count();
+  }
+
+private:
+  uint64_t* counter_;
+  clock::time_point start_;
+};
+
+//! handles classified config file lines, keeping track of the section
+template <class Target>
+class config_handler
+{
+public:
+  config_handler(option_set& options, Target& target)
+      : options_(options)
+      , target_(target)
+      , values_(0)
+  {
+  }
+
+  void handle(const char* begin, const char* end, int lineno, const detail::config_line& line);
+
+  //! number of values handled
+  size_t values() const { return values_; }
+
+private:
+  option_set& options_;
+  Target& target_;
+  size_t values_;
+  std::string section_;
+  std::string key_;
+};
+
+template <class Target>
+void config_handler<Target>::handle(const char* begin, const char* end, int lineno, const detail::config_line& line)
+{
+  switch (line.kind) {
+  case detail::LINE_EMPTY:
+  case detail::LINE_COMMENT:
+    break;
+  case detail::LINE_SECTION:
+    section_.assign(line.key_begin, line.key_end);
+    section_ += '.';
+    break;
+  case detail::LINE_VALUE:
+    values_ += 1;
+    key_.assign(section_);
+    key_.append(line.key_begin, line.key_end);
+    try {
+      target_.at(lineno);
+      target_.put(options_.find_option(key_, false), line.value_begin, line.value_end);
+    } catch (option_error& oe) {
       std::ostringstream msg;
-      msg << "bad line " << lineno << ": " << line;
+      msg << "lineno ";
+      msg.write(begin, end - begin);
+      msg << ": " << oe.what();
       throw option_error(msg.str());
     }
+    break;
+  case detail::LINE_BAD: {
+    std::ostringstream msg;
+    msg << "bad line " << lineno << ": ";
+    msg.write(begin, end - begin);
+    throw option_error(msg.str());
+  }
+  }
+}
+
+template <class Target>
+void parse_config_stream(std::istream& infile, option_set& options, Target& target)
+{
+  parse_stats* stats = options.stats();
+  stats_timer timer(stats, &parse_stats::config_ns);
+  detail::line_reader reader(infile);
+  config_handler<Target> handler(options, target);
+  const char *begin, *end;
+  int lineno = 1;
+  uint64_t bytes = 0;
+  for (; reader.next(begin, end); ++lineno) {
+    bytes += end - begin + (reader.newline() ? 1 : 0);
+    detail::config_line line;
+    detail::scan_config_line(begin, end, line);
+    handler.handle(begin, end, lineno, line);
   }
   if (!infile.eof() && infile.bad())
     throw option_error("error reading config");
-  return values;
+  if (stats) {
+    stats->lines += lineno - 1;
+    stats->bytes += bytes;
+    stats->values += handler.values();
+  }
 }
 
-value_set parse_command_line(const std::vector<std::string>& argv, option_set& options, std::vector<std::string>& positional)
+void read_all(std::istream& infile, std::string& buffer)
 {
-  value_set values;
-  static const std::regex re_option("(-{1,2})(" OPTION_CHARS ")(=(.*))?");
-  enum { GO_ALL, GO_DASH, GO_KEY, GO_EQ_VALUE, GO_VALUE };
+  const size_t block = 1024 * 1024;
+  size_t fill = 0;
+  while (infile) {
+    buffer.resize(fill + block);
+    infile.read(&buffer[fill], block);
+    fill += infile.gcount();
+  }
+  buffer.resize(fill);
+  if (!infile.eof() && infile.bad())
+    throw option_error("error reading config");
+}
+
+/*!
+ * Parse a config file in memory, lexing chunks of about CHUNK_SIZE
+ * bytes on up to threads threads.
+ *
+ * Lexing does not depend on the section, so it can be done out of
+ * order. The lexed lines are handled in file order in the calling
+ * thread, so that sections, composing, overwriting and errors are
+ * exactly as in parse_config_stream.
+ */
+template <class Target>
+void parse_config_buffer(const char* begin, const char* end, option_set& options, Target& target, size_t threads)
+{
+  parse_stats* stats = options.stats();
+  stats_timer timer(stats, &parse_stats::config_ns);
+  const size_t CHUNK_SIZE = 1024 * 1024;
+  std::vector<const char*> bounds(1, begin);
+  while (size_t(end - bounds.back()) > CHUNK_SIZE) {
+    const char* from = bounds.back() + CHUNK_SIZE;
+    const char* nl = static_cast<const char*>(std::memchr(from, '\n', end - from));
+    if (!nl || nl + 1 == end)
+      break;
+    bounds.push_back(nl + 1);
+  }
+  bounds.push_back(end);
+  const size_t n_chunks = bounds.size() - 1;
+
+  struct chunk
+  {
+    std::vector<detail::lexed_line> lines;
+    int count;
+    bool done;
+    std::exception_ptr error;
+  };
+  std::vector<chunk> chunks(n_chunks);
+
+  std::mutex mutex;
+  std::condition_variable changed;
+  size_t next = 0, handled = 0;
+  bool stop = false;
+  const size_t window = 2 * threads; // limit the memory used for lexed lines
+
+  auto lex = [&]() {
+    while (true) {
+      size_t c;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return stop || next == n_chunks || next < handled + window; });
+        if (stop || next == n_chunks)
+          return;
+        c = next++;
+      }
+      std::vector<detail::lexed_line> lines;
+      int count = 0;
+      std::exception_ptr error;
+      try {
+        count = detail::scan_config_lines(bounds[c], bounds[c + 1], lines);
+      } catch (...) {
+        error = std::current_exception();
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        chunks[c].lines.swap(lines);
+        chunks[c].count = count;
+        chunks[c].error = error;
+        chunks[c].done = true;
+      }
+      changed.notify_all();
+    }
+  };
+
+  std::vector<std::thread> workers;
+  struct joiner
+  {
+    std::vector<std::thread>& workers;
+    std::mutex& mutex;
+    std::condition_variable& changed;
+    bool& stop;
+    ~joiner()
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+      }
+      changed.notify_all();
+      for (std::thread& w : workers)
+        w.join();
+    }
+  } join_workers{workers, mutex, changed, stop};
+  if (threads > 1 && n_chunks > 1) {
+    for (size_t t = 0; t < threads && t < n_chunks; ++t)
+      workers.push_back(std::thread(lex));
+  }
+
+  config_handler<Target> handler(options, target);
+  int lineno_offset = 0;
+  for (size_t c = 0; c < n_chunks; ++c) {
+    chunk& ch = chunks[c];
+    if (workers.empty()) {
+      ch.count = detail::scan_config_lines(bounds[c], bounds[c + 1], ch.lines);
+    } else {
+      std::unique_lock<std::mutex> lock(mutex);
+      changed.wait(lock, [&]() { return ch.done; });
+    }
+    if (ch.error)
+      std::rethrow_exception(ch.error);
+    for (const detail::lexed_line& l : ch.lines)
+      handler.handle(l.begin, l.end, lineno_offset + l.lineno, l.line);
+    lineno_offset += ch.count;
+    std::vector<detail::lexed_line>().swap(ch.lines);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      handled = c + 1;
+    }
+    changed.notify_all();
+  }
+  if (stats) {
+    stats->lines += lineno_offset;
+    stats->bytes += end - begin;
+    stats->values += handler.values();
+  }
+}
+
+size_t config_threads(const config_settings& settings)
+{
+  return settings.threads() ? settings.threads() : std::max(1u, std::thread::hardware_concurrency());
+}
+
+template <class Target>
+void parse_config_stream(std::istream& infile, option_set& options, Target& target, const config_settings& settings)
+{
+  const size_t threads = config_threads(settings);
+  if (threads == 1)
+    return parse_config_stream(infile, options, target);
+
+  std::string buffer;
+  {
+    stats_timer timer(options.stats(), &parse_stats::read_ns);
+    read_all(infile, buffer);
+  }
+  parse_config_buffer(buffer.data(), buffer.data() + buffer.size(), options, target, threads);
+}
+
+template <class Target>
+void parse_config_filename(const std::string& filename, option_set& options, Target& target, const config_settings& settings)
+{
+  // if enabled, regular files are parsed directly from a memory map, pipes etc from a stream
+  detail::mapped_file mapped;
+  std::ifstream infile;
+  {
+    stats_timer timer(options.stats(), &parse_stats::read_ns);
+    if (!settings.memory_map() || !mapped.map(filename)) {
+      infile.open(filename);
+      if (!infile)
+        throw option_error("cannot read config file '" + filename + "'");
+    }
+  }
+
+  try {
+    if (infile.is_open())
+      parse_config_stream(infile, options, target, settings);
+    else
+      parse_config_buffer(mapped.begin(), mapped.end(), options, target, config_threads(settings));
+  } catch (option_error& oe) {
+    throw option_error("while reading '" + filename + ": " + oe.what());
+  }
+}
+
+//! arguments from a vector of strings
+class string_args
+{
+public:
+  explicit string_args(const std::vector<std::string>& argv)
+      : argv_(argv)
+      , next_(0)
+  {
+  }
+
+  bool next(const char*& begin, const char*& end)
+  {
+    if (next_ == argv_.size())
+      return false;
+    begin = argv_[next_].data();
+    end = begin + argv_[next_].size();
+    next_ += 1;
+    return true;
+  }
+
+  //! index of the last argument returned by next
+  int position() const { return next_ - 1; }
+
+  //! arguments returned by next so far are no longer needed
+  void release() {}
+
+private:
+  const std::vector<std::string>& argv_;
+  size_t next_;
+};
+
+//! arguments from main's argv, without argv[0]
+class c_args
+{
+public:
+  c_args(int argc, const char* const* argv)
+      : argc_(argc)
+      , argv_(argv)
+      , next_(1)
+  {
+  }
+
+  bool next(const char*& begin, const char*& end)
+  {
+    if (next_ >= argc_)
+      return false;
+    begin = argv_[next_];
+    end = begin + std::strlen(begin);
+    next_ += 1;
+    return true;
+  }
+
+  int position() const { return next_ - 1; }
+  void release() {}
+
+private:
+  int argc_;
+  const char* const* argv_;
+  int next_;
+};
+
+#if defined(__unix__) || defined(__APPLE__)
+std::string canonical_filename(const std::string& filename)
+{
+  char* resolved = ::realpath(filename.c_str(), nullptr);
+  if (!resolved)
+    return filename;
+  const std::string canonical(resolved);
+  std::free(resolved);
+  return canonical;
+}
+#else
+std::string canonical_filename(const std::string& filename)
+{
+  return filename;
+}
+#endif
+
+/*!
+ * Arguments from Args, with "@file" replaced by the tokens in file.
+ *
+ * Response files are memory mapped where possible, and stay open until
+ * release, so that tokens pointing into them stay valid. Unquoted tokens
+ * are kept in strings that are reused after release.
+ */
+template <class Args>
+class response_file_args
+{
+public:
+  explicit response_file_args(Args& args)
+      : args_(args)
+      , unquoted_used_(0)
+  {
+  }
+
+  bool next(const char*& begin, const char*& end);
+
+  //! index in argv of the last argument, or of the response file it came from
+  int position() const { return args_.position(); }
+
+  void release();
+
+private:
+  void open(const std::string& filename);
+
+private:
+  struct file
+  {
+    detail::mapped_file mapped;
+    std::string buffer;
+    std::string canonical;
+    const char* pos;
+    const char* end;
+  };
+
+  Args& args_;
+  std::vector<std::unique_ptr<file>> files_;
+  std::vector<file*> reading_;
+
+  //! a deque, so that growing it does not move the strings and their data
+  std::deque<std::string> unquoted_;
+  size_t unquoted_used_;
+};
+
+template <class Args>
+bool response_file_args<Args>::next(const char*& begin, const char*& end)
+{
+  while (true) {
+    if (reading_.empty()) {
+      if (!args_.next(begin, end))
+        return false;
+    } else {
+      file& f = *reading_.back();
+      if (unquoted_used_ == unquoted_.size())
+        unquoted_.emplace_back();
+      const detail::response_token t = detail::scan_response_token(f.pos, f.end, begin, end, unquoted_[unquoted_used_]);
+      if (t == detail::RESPONSE_END) {
+        reading_.pop_back();
+        continue;
+      } else if (t == detail::RESPONSE_BAD) {
+        throw option_error("unterminated quote or escape in response file '" + f.canonical + "'");
+      } else if (t == detail::RESPONSE_UNQUOTED) {
+        unquoted_used_ += 1;
+      }
+    }
+    if (end - begin > 1 && *begin == '@') {
+      open(std::string(begin + 1, end));
+      continue;
+    }
+    return true;
+  }
+}
+
+template <class Args>
+void response_file_args<Args>::release()
+{
+  args_.release();
+  unquoted_used_ = 0;
+  // close the files that were read to the end
+  files_.erase(std::remove_if(files_.begin(), files_.end(),
+                              [this](const std::unique_ptr<file>& f) {
+                                return std::find(reading_.begin(), reading_.end(), f.get()) == reading_.end();
+                              }),
+               files_.end());
+}
+
+template <class Args>
+void response_file_args<Args>::open(const std::string& filename)
+{
+  std::unique_ptr<file> f(new file);
+  f->canonical = canonical_filename(filename);
+  for (const file* r : reading_) {
+    if (r->canonical == f->canonical)
+      throw option_error("response file '" + filename + "' includes itself");
+  }
+
+  if (f->mapped.map(filename)) {
+    f->pos = f->mapped.begin();
+    f->end = f->mapped.end();
+  } else {
+    std::ifstream infile(filename);
+    if (!infile)
+      throw option_error("cannot read response file '" + filename + "'");
+    read_all(infile, f->buffer);
+    f->pos = f->buffer.data();
+    f->end = f->buffer.data() + f->buffer.size();
+  }
+  reading_.push_back(f.get());
+  files_.push_back(std::move(f));
+}
+
+template <class Args, class Target>
+void parse_args(Args& argv, option_set& options, Target& target)
+{
+  parse_stats* stats = options.stats();
+  stats_timer timer(stats, &parse_stats::command_line_ns);
+  size_t arguments = 0, values = 0;
   bool end_of_options_marker = false;
-  const int argc = argv.size();
-  for (int a = 0; a < argc; ++a) {
-    const std::string arg(argv[a]);
-    if (arg == "--") {
+  std::string key;
+  std::vector<value_range> args;
+  const char *arg_begin, *arg_end;
+  const auto next_arg = [&](const char*& begin, const char*& end) {
+    if (!argv.next(begin, end))
+      return false;
+    arguments += 1;
+    return true;
+  };
+  // each argument with its values is passed to target before the next one is read
+  for (; next_arg(arg_begin, arg_end); argv.release()) {
+    target.at(argv.position());
+    if (arg_end - arg_begin == 2 && arg_begin[0] == '-' && arg_begin[1] == '-') {
       end_of_options_marker = true;
       continue;
     }
-    std::smatch match;
-    if (!end_of_options_marker && std::regex_match(arg, match, re_option)) {
-      option_cx opt = options.find_option(match[GO_KEY], match[GO_DASH].length() == 1);
-      if (match[GO_VALUE].matched) {
+    detail::option_token token;
+    if (!end_of_options_marker && detail::scan_option(arg_begin, arg_end, token)) {
+      key.assign(token.key_begin, token.key_end);
+      option_cx opt = options.find_option(key, token.shortkey);
+      values += 1;
+      if (token.has_value) {
         if (opt->narg() == 0) {
           throw option_error("arg for no-arg option '" + opt->key() + "'");
         } else if (!opt->is_composing() && opt->narg() != 1) {
@@ -117,48 +687,422 @@ value_set parse_command_line(const std::vector<std::string>& argv, option_set& o
           msg << "args for option '" + opt->key() + "', which expects exactly " << opt->narg() << " values, cannot be passed with '='";
           throw option_error(msg.str());
         }
-        values.put(opt, match[GO_VALUE].str());
+        target.put(opt, token.value_begin, token.value_end);
       } else if (opt->has_implicit_value()) {
-        values.put_implicit(opt);
+        target.put_implicit(opt);
       } else if (opt->narg() == 0) {
-        values.put(opt, std::string());
-      } else if (opt->is_composing() && a + 1 < argc) {
-        values.put(opt, argv[++a]);
-      } else if (!opt->is_composing() && a + (int)opt->narg() < argc) {
-        string_v args;
-        args.reserve(opt->narg());
-        const int alast = a + opt->narg();
-        while (a < alast)
-          args.push_back(argv[++a]);
-        values.put(opt, args);
+        target.put(opt, arg_end, arg_end);
       } else {
-        throw option_error("no arg for option '" + opt->key() + "'");
+        // composing options take one value per occurrence
+        const size_t narg = opt->is_composing() ? 1 : opt->narg();
+        args.clear();
+        value_range v;
+        while (args.size() < narg && next_arg(v.begin, v.end))
+          args.push_back(v);
+        if (args.size() < narg)
+          throw option_error("no arg for option '" + opt->key() + "'");
+        if (narg == 1)
+          target.put(opt, args[0].begin, args[0].end);
+        else
+          target.put(opt, args.data(), args.size());
+        values += narg - 1;
       }
     } else {
-      positional.push_back(arg);
+      target.put_positional(arg_begin, arg_end);
     }
   }
+  if (stats) {
+    stats->arguments += arguments;
+    stats->values += values;
+  }
+}
+
+//! parse arguments, expanding response files if enabled for options
+template <class Args, class Target>
+void parse_args_expanded(Args argv, option_set& options, Target& target)
+{
+  if (options.response_files()) {
+    response_file_args<Args> expanded(argv);
+    parse_args(expanded, options, target);
+  } else {
+    parse_args(argv, options, target);
+  }
+}
+
+//! throw if argv has a response file, for targets keeping pointers to positional arguments
+void check_no_response_files(int argc, const char* const argv[], const option_set& options)
+{
+  if (!options.response_files())
+    return;
+  for (int a = 1; a < argc; ++a) {
+    if (argv[a][0] == '@' && argv[a][1] != 0)
+      throw option_error(std::string("response file '") + argv[a] + "' needs std::string positional arguments");
+  }
+}
+
+//! parser output into a value_set, recording the options that were set
+struct recording_target
+{
+  value_set& values;
+  std::vector<option_cx>* options;
+
+  void at(int) {}
+  void put(option_cx opt, const char* begin, const char* end)
+  {
+    values.emplace(opt, begin, end);
+    options->push_back(opt);
+  }
+};
+
+uint64_t fnv1a(const char* begin, const char* end)
+{
+  uint64_t h = 14695981039346656037ull;
+  for (; begin != end; ++begin) {
+    h ^= static_cast<unsigned char>(*begin);
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+} // namespace
+
+value_receiver::~value_receiver() {}
+
+option_visitor::~option_visitor() {}
+
+positional_sink::~positional_sink() {}
+
+void option_visitor::visit_positional(const value_range&, const source_location&) {}
+
+config_settings::config_settings()
+    : threads_(1)
+    , memory_map_(false)
+{
+}
+
+config_settings& config_settings::set_threads(size_t n)
+{
+  threads_ = n;
+  return *this;
+}
+
+config_settings& config_settings::set_cache_file(const std::string& cache_file)
+{
+  cache_file_ = cache_file;
+  return *this;
+}
+
+config_settings& config_settings::set_memory_map(bool enable)
+{
+  memory_map_ = enable;
+  return *this;
+}
+
+value_set parse_config_file(const std::string& filename, option_set& options)
+{
+  return parse_config_file(filename, options, config_settings());
+}
+
+value_set parse_config_file(const std::string& filename, option_set& options, const config_settings& settings)
+{
+  value_set values;
+  if (!settings.cache_file().empty() && load_value_cache(settings.cache_file(), options, filename, values))
+    return values;
+
+  // stamp before parsing, so that a file changed while parsing does not match the cache
+  uint64_t source_size = 0;
+  int64_t source_mtime = 0;
+  const bool save_cache = !settings.cache_file().empty() && detail::file_stamp(filename, source_size, source_mtime);
+
+  value_set_target target{values};
+  parse_config_filename(filename, options, target, settings);
+
+  if (save_cache) {
+    try {
+      detail::save_value_cache(settings.cache_file(), values, options, source_size, source_mtime);
+    } catch (option_error&) {
+      // the cache is only an optimization
+    }
+  }
+  return values;
+}
+
+value_set parse_config_file(std::istream& infile, option_set& options, const config_settings& settings)
+{
+  value_set values;
+  value_set_target target{values};
+  parse_config_stream(infile, options, target, settings);
+  return values;
+}
+
+value_set parse_config_file(std::istream& infile, option_set& options)
+{
+  value_set values;
+  value_set_target target{values};
+  parse_config_stream(infile, options, target);
+  return values;
+}
+
+void parse_config_file(const std::string& filename, option_set& options, value_receiver& values)
+{
+  receiver_target target{values};
+  parse_config_filename(filename, options, target, config_settings());
+}
+
+void parse_config_file(std::istream& infile, option_set& options, value_receiver& values)
+{
+  receiver_target target{values};
+  parse_config_stream(infile, options, target);
+}
+
+void parse_config_file(const std::string& filename, option_set& options, option_visitor& visitor)
+{
+  visitor_target target{visitor, {source_location::CONFIG_FILE, filename.c_str(), 0}};
+  parse_config_filename(filename, options, target, config_settings());
+}
+
+void parse_config_file(std::istream& infile, option_set& options, option_visitor& visitor)
+{
+  visitor_target target{visitor, {source_location::CONFIG_FILE, nullptr, 0}};
+  parse_config_stream(infile, options, target);
+}
+
+incremental_config_parser::incremental_config_parser(option_set& options)
+    : options_(options)
+    , full_parse_(false)
+{
+}
+
+std::vector<option_cx> incremental_config_parser::parse(const std::string& filename)
+{
+  // read a private copy, a mapped file truncated by an editor would raise SIGBUS
+  std::string buffer;
+  std::ifstream infile(filename);
+  if (!infile)
+    throw option_error("cannot read config file '" + filename + "'");
+  read_all(infile, buffer);
+
+  try {
+    return parse_buffer(buffer.data(), buffer.data() + buffer.size());
+  } catch (option_error& oe) {
+    throw option_error("while reading '" + filename + ": " + oe.what());
+  }
+}
+
+std::vector<option_cx> incremental_config_parser::parse(std::istream& infile)
+{
+  std::string buffer;
+  read_all(infile, buffer);
+  return parse_buffer(buffer.data(), buffer.data() + buffer.size());
+}
+
+std::vector<option_cx> incremental_config_parser::parse_buffer(const char* begin, const char* end)
+{
+  // split before each section line, the first segment may be empty
+  segments_t segments(1);
+  segments.back().begin = 0;
+  segments.back().first_line = 0;
+  int lineno = 0;
+  for (const char* line = begin; line != end; ++lineno) {
+    const char* nl = static_cast<const char*>(std::memchr(line, '\n', end - line));
+    const char* line_end = nl ? nl : end;
+    const char* first = line;
+    while (first != line_end && detail::is_space(*first))
+      ++first;
+    detail::config_line cl;
+    if (first != line_end && *first == '[' && detail::scan_config_line(line, line_end, cl) == detail::LINE_SECTION) {
+      segments.back().end = line - begin;
+      segment s;
+      s.begin = line - begin;
+      s.first_line = lineno;
+      segments.push_back(s);
+    }
+    line = nl ? nl + 1 : end;
+  }
+  segments.back().end = end - begin;
+  for (segment& s : segments)
+    s.hash = fnv1a(begin + s.begin, begin + s.end);
+
+  bool full = (segments.size() != segments_.size());
+  std::vector<size_t> changed_segments;
+  for (size_t i = 0; !full && i < segments.size(); ++i) {
+    if (segments[i].end - segments[i].begin != segments_[i].end - segments_[i].begin || segments[i].hash != segments_[i].hash)
+      changed_segments.push_back(i);
+    else
+      segments[i].options = segments_[i].options;
+  }
+  if (!full && changed_segments.empty()) {
+    full_parse_ = false;
+    return std::vector<option_cx>();
+  }
+
+  std::vector<detail::lexed_line> lines;
+  const auto lex_segment = [&](config_handler<recording_target>& handler, const segment& s) {
+    lines.clear();
+    detail::scan_config_lines(begin + s.begin, begin + s.end, lines);
+    for (const detail::lexed_line& l : lines)
+      handler.handle(l.begin, l.end, s.first_line + l.lineno, l.line);
+  };
+
+  value_set values;
+  std::vector<option_cx> changed;
+  if (!full) {
+    value_set fresh;
+    recording_target target{fresh, nullptr};
+    for (size_t i : changed_segments) {
+      config_handler<recording_target> handler(options_, target);
+      target.options = &segments[i].options;
+      lex_segment(handler, segments[i]);
+    }
+
+    // patching is only possible if each changed option is set in just one segment
+    std::set<option_cx> unchanged_options;
+    for (size_t i = 0, c = 0; i < segments.size(); ++i) {
+      if (c < changed_segments.size() && changed_segments[c] == i)
+        c += 1;
+      else
+        unchanged_options.insert(segments[i].options.begin(), segments[i].options.end());
+    }
+    std::map<option_cx, size_t> changed_options_owner;
+    for (size_t i : changed_segments) {
+      for (const segments_t* from : {&segments_, &segments}) {
+        for (option_cx opt : (*from)[i].options) {
+          const std::pair<std::map<option_cx, size_t>::iterator, bool> owner = changed_options_owner.insert(std::make_pair(opt, i));
+          if (unchanged_options.count(opt) || owner.first->second != i)
+            full = true;
+        }
+      }
+    }
+
+    if (!full) {
+      values = values_;
+      for (const auto& o : changed_options_owner)
+        values.erase(o.first);
+      values.add(std::move(fresh));
+      for (const auto& o : changed_options_owner) {
+        const string_v* before = values_.get(o.first);
+        const string_v* after = values.get(o.first);
+        if ((before == nullptr) != (after == nullptr) || (before && *before != *after))
+          changed.push_back(o.first);
+      }
+    }
+  }
+
+  if (full) {
+    recording_target target{values, nullptr};
+    config_handler<recording_target> handler(options_, target);
+    for (segment& s : segments) {
+      s.options.clear();
+      target.options = &s.options;
+      lex_segment(handler, s);
+    }
+    changed = changed_options(options_, values_, values);
+  }
+
+  for (segment& s : segments) {
+    std::sort(s.options.begin(), s.options.end());
+    s.options.erase(std::unique(s.options.begin(), s.options.end()), s.options.end());
+  }
+  values_ = std::move(values);
+  segments_.swap(segments);
+  full_parse_ = full;
+  return changed;
+}
+
+value_set parse_command_line(const std::vector<std::string>& argv, option_set& options, std::vector<std::string>& positional)
+{
+  value_set values;
+  auto target = make_target(values, positional, make_string);
+  parse_args_expanded(string_args(argv), options, target);
   return values;
 }
 
 value_set parse_command_line(int argc, char* argv[], option_set& options, std::vector<std::string>& positional)
 {
-  return parse_command_line(std::vector<std::string>(argv + 1, argv + argc), options, positional);
+  value_set values;
+  auto target = make_target(values, positional, make_string);
+  parse_args_expanded(c_args(argc, argv), options, target);
+  return values;
+}
+
+value_set parse_command_line(const std::vector<std::string>& argv, option_set& options, positional_sink& positional)
+{
+  value_set values;
+  value_set_sink_target target(values, positional);
+  parse_args_expanded(string_args(argv), options, target);
+  return values;
+}
+
+value_set parse_command_line(int argc, char* argv[], option_set& options, positional_sink& positional)
+{
+  value_set values;
+  value_set_sink_target target(values, positional);
+  parse_args_expanded(c_args(argc, argv), options, target);
+  return values;
+}
+
+value_set parse_command_line(int argc, const char* const argv[], option_set& options, std::vector<const char*>& positional)
+{
+  value_set values;
+  check_no_response_files(argc, argv, options);
+  auto target = make_target(values, positional, make_c_string);
+  c_args args(argc, argv);
+  parse_args(args, options, target);
+  return values;
+}
+
+void parse_command_line(int argc, const char* const argv[], option_set& options, value_receiver& values)
+{
+  check_no_response_files(argc, argv, options);
+  receiver_target target{values};
+  c_args args(argc, argv);
+  parse_args(args, options, target);
+}
+
+void parse_command_line(int argc, const char* const argv[], option_set& options, option_visitor& visitor)
+{
+  visitor_target target{visitor, {source_location::COMMAND_LINE, nullptr, 0}};
+  parse_args_expanded(c_args(argc, argv), options, target);
+}
+
+positional_args_consumer::positional_args_consumer(value_set& vm, string_v&& pa)
+    : values_(vm)
+    , owned_(std::move(pa))
+    , positional_(owned_)
+    , pbegin_(positional_.begin())
+{
+}
+
+positional_args_consumer::positional_args_consumer(const positional_args_consumer& other)
+    : values_(other.values_)
+    , owned_(other.owned_)
+    , positional_(other.owns_positional() ? owned_ : other.positional_)
+    , pbegin_(positional_.begin() + (other.pbegin_ - other.positional_.begin()))
+{
 }
 
 positional_args_consumer& positional_args_consumer::operator>>(const option& opt)
 {
-  if (opt.is_composing()) {
-    values_.put(&opt, *pbegin_++);
-  } else if (!values_.is_set(opt)) {
-    if (std::distance(begin(), end()) >= (int)opt.narg()) {
-      const string_v::const_iterator opt_end = begin() + opt.narg();
-      values_.put(&opt, string_v(begin(), opt_end));
-      pbegin_ = opt_end;
-    } else {
-      throw option_error("positional arg error for option '" + opt.key() + "'");
-    }
+  if (!opt.is_composing() && values_.is_set(opt))
+    return *this;
+
+  const size_t narg = opt.is_composing() ? 1 : opt.narg();
+  if (std::distance(begin(), end()) < (int)narg)
+    throw option_error("positional arg error for option '" + opt.key() + "'");
+
+  const string_v::const_iterator opt_end = begin() + narg;
+  if (owns_positional()) {
+    const string_v::iterator b = owned_.begin() + (pbegin_ - owned_.cbegin());
+    if (opt.is_composing())
+      values_.put(&opt, std::move(*b));
+    else
+      values_.put(&opt, string_v(std::make_move_iterator(b), std::make_move_iterator(b + narg)));
+  } else if (opt.is_composing()) {
+    values_.put(&opt, *pbegin_);
+  } else {
+    values_.put(&opt, string_v(begin(), opt_end));
   }
+  pbegin_ = opt_end;
   return *this;
 }
 
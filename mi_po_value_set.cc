@@ -29,12 +29,64 @@
 
 #include "mi_programoptions.h"
 
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
 namespace miutil {
 namespace program_options {
 
+value_set::conversion::~conversion() {}
+
+value_set::slot::slot()
+    : opt(nullptr)
+    , converted(nullptr)
+{
+}
+
+// conversions are not copied, other threads may add to other.converted
+value_set::slot::slot(const slot& other)
+    : opt(other.opt)
+    , values(other.values)
+    , converted(nullptr)
+{
+}
+
+value_set::slot::slot(slot&& other) noexcept
+    : opt(other.opt)
+    , values(std::move(other.values))
+    , converted(other.converted.exchange(nullptr))
+{
+}
+
+value_set::slot& value_set::slot::operator=(const slot& other)
+{
+  if (this != &other) {
+    clear_converted();
+    opt = other.opt;
+    values = other.values;
+  }
+  return *this;
+}
+
+value_set::slot::~slot()
+{
+  clear_converted();
+}
+
+void value_set::slot::clear_converted()
+{
+  const conversion* c = converted.exchange(nullptr);
+  while (c) {
+    const conversion* next = c->next;
+    delete c;
+    c = next;
+  }
+}
+
 bool value_set::is_set(option_cx opt) const
 {
-  return opt && (values_.find(opt) != values_.end());
+  return opt && get(opt);
 }
 
 void value_set::put_implicit(option_cx opt)
@@ -48,42 +100,134 @@ void value_set::put_implicit(option_cx opt)
   put(opt, opt->implicit_value());
 }
 
-void value_set::put(option_cx opt, const string_v& values)
+value_set::slot& value_set::put_slot(option_cx opt, size_t count)
 {
   if (!opt)
     throw option_error("option is null");
   if (opt->is_composing()) {
-    if (values.size() != 1)
+    if (count != 1)
       throw option_error("option '" + opt->key() + "' is composing, cannot #values != 1");
   } else {
     if (is_set(opt) && !opt->is_overwriting())
       throw option_error("option '" + opt->key() + "' already set and not composing or overwriting");
   }
 
-  string_v& v = values_[opt];
+  slot& s = insert(opt);
+  s.clear_converted();
   if (opt->is_overwriting())
-    v.clear();
+    s.values.clear();
+  return s;
+}
+
+void value_set::put(option_cx opt, const string_v& values)
+{
+  string_v& v = put_slot(opt, values.size()).values;
   v.insert(v.end(), values.begin(), values.end());
 }
 
-const string_v* value_set::get(option_cx opt) const
+void value_set::put(option_cx opt, string_v&& values)
+{
+  string_v& v = put_slot(opt, values.size()).values;
+  if (v.empty())
+    v.swap(values);
+  else
+    v.insert(v.end(), std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+}
+
+void value_set::put(option_cx opt, const std::string& value)
+{
+  put_slot(opt, 1).values.push_back(value);
+}
+
+void value_set::put(option_cx opt, std::string&& value)
+{
+  put_slot(opt, 1).values.push_back(std::move(value));
+}
+
+void value_set::emplace(option_cx opt, const char* begin, const char* end)
+{
+  put_slot(opt, 1).values.emplace_back(begin, end);
+}
+
+void value_set::erase(option_cx opt)
+{
+  if (!opt)
+    throw option_error("option is null");
+  const size_t ordinal = opt->ordinal();
+  if (ordinal < slots_.size() && slots_[ordinal].opt == opt) {
+    slot& s = slots_[ordinal];
+    s.clear_converted();
+    s.opt = nullptr;
+    s.values.clear();
+  } else if (!values_.empty()) {
+    values_.erase(opt);
+  }
+}
+
+value_set::slot& value_set::insert(option_cx opt)
+{
+  const size_t ordinal = opt->ordinal();
+  if (ordinal != option::NO_ORDINAL) {
+    if (ordinal >= slots_.size())
+      slots_.resize(ordinal + 1);
+    slot& s = slots_[ordinal];
+    if (!s.opt) {
+      // a slot freed by erase, opt may still have values in the map
+      values_t::iterator it = values_.empty() ? values_.end() : values_.find(opt);
+      if (it != values_.end()) {
+        s = std::move(it->second);
+        values_.erase(it);
+      }
+      s.opt = opt;
+    }
+    if (s.opt == opt)
+      return s;
+  }
+  slot& s = values_[opt];
+  s.opt = opt;
+  return s;
+}
+
+const value_set::slot* value_set::find_slot(option_cx opt) const
 {
   if (!opt)
     throw option_error("option is null");
-  values_t::const_iterator it = values_.find(opt);
-  if (it != values_.end())
-    return &it->second;
+  const size_t ordinal = opt->ordinal();
+  if (ordinal < slots_.size() && slots_[ordinal].opt == opt)
+    return &slots_[ordinal];
+  if (!values_.empty()) {
+    values_t::const_iterator it = values_.find(opt);
+    if (it != values_.end())
+      return &it->second;
+  }
   return nullptr;
 }
 
-const string_v& value_set::values(option_cx opt) const
+const value_set::slot& value_set::set_slot(option_cx opt) const
 {
-  if (const string_v* values = get(opt))
-    return *values;
+  if (const slot* s = find_slot(opt))
+    return *s;
 
   throw option_error("option '" + opt->key() + "' not set and without default");
 }
 
+void value_set::throw_convert_error(option_cx opt, const std::string& text)
+{
+  throw option_error("option '" + opt->key() + "' has invalid value '" + text + "'");
+}
+
+const string_v* value_set::get(option_cx opt) const
+{
+  if (const slot* s = find_slot(opt))
+    return &s->values;
+  return nullptr;
+}
+
+const string_v& value_set::values(option_cx opt) const
+{
+  return set_slot(opt).values;
+}
+
 const std::string& value_set::value(option_cx opt, size_t index) const
 {
   if (const string_v* values = get(opt))
@@ -99,6 +243,13 @@ const std::string& value_set::value(option_cx opt, size_t index) const
 
 option_cx value_set::find(const std::string& key, bool use_shortkey) const
 {
+  for (const auto& s : slots_) {
+    if (!s.opt)
+      continue;
+    const std::string& k = use_shortkey ? s.opt->shortkey() : s.opt->key();
+    if (!k.empty() && k == key)
+      return s.opt;
+  }
   for (const auto& o : values_) {
     const std::string& k = use_shortkey ? o.first->shortkey() : o.first->key();
     if (!k.empty() && k == key)
@@ -109,10 +260,257 @@ option_cx value_set::find(const std::string& key, bool use_shortkey) const
 
 void value_set::add(const value_set& other)
 {
+  for (const auto& s : other.slots_) {
+    if (!s.opt)
+      continue;
+    if (is_set(s.opt))
+      throw option_error("option '" + s.opt->key() + "' already set");
+    insert(s.opt) = s;
+  }
   for (const auto& o : other.values_) {
-    if (!values_.insert(o).second)
+    if (is_set(o.first))
+      throw option_error("option '" + o.first->key() + "' already set");
+    insert(o.first) = o.second;
+  }
+}
+
+void value_set::add(value_set&& other)
+{
+  if (slots_.empty() && values_.empty()) {
+    slots_.swap(other.slots_);
+    values_.swap(other.values_);
+    return;
+  }
+
+  for (auto& s : other.slots_) {
+    if (s.opt && is_set(s.opt))
+      throw option_error("option '" + s.opt->key() + "' already set");
+  }
+  for (auto& o : other.values_) {
+    if (is_set(o.first))
       throw option_error("option '" + o.first->key() + "' already set");
   }
+  for (auto& s : other.slots_) {
+    if (s.opt) {
+      slot& target = insert(s.opt);
+      target.clear_converted();
+      target.values.swap(s.values);
+    }
+  }
+  for (auto& o : other.values_) {
+    slot& target = insert(o.first);
+    target.clear_converted();
+    target.values.swap(o.second.values);
+  }
+  other.slots_.clear();
+  other.values_.clear();
+}
+
+std::vector<option_cx> changed_options(const option_set& options, const value_set& a, const value_set& b)
+{
+  std::vector<option_cx> changed;
+  for (option_cx opt : options) {
+    const string_v* va = a.get(opt);
+    const string_v* vb = b.get(opt);
+    if ((va == nullptr) != (vb == nullptr) || (va && *va != *vb))
+      changed.push_back(opt);
+  }
+  return changed;
+}
+
+layered_values& layered_values::push(const value_set& layer)
+{
+  layers_.push_back(&layer);
+  return *this;
+}
+
+const value_set* layered_values::top_layer(option_cx opt) const
+{
+  for (std::vector<const value_set*>::const_reverse_iterator it = layers_.rbegin(); it != layers_.rend(); ++it) {
+    if ((*it)->is_set(opt))
+      return *it;
+  }
+  return nullptr;
+}
+
+size_t layered_values::count(option_cx opt) const
+{
+  if (!opt)
+    throw option_error("option is null");
+  if (!opt->is_composing()) {
+    const value_set* layer = top_layer(opt);
+    return layer ? layer->get(opt)->size() : 0;
+  }
+  size_t n = 0;
+  for (const value_set* layer : layers_) {
+    if (const string_v* values = layer->get(opt))
+      n += values->size();
+  }
+  return n;
+}
+
+const std::string& layered_values::value(option_cx opt, size_t index) const
+{
+  if (!opt)
+    throw option_error("option is null");
+  if (!opt->is_composing()) {
+    if (const value_set* layer = top_layer(opt))
+      return layer->value(opt, index);
+  } else {
+    bool set = false;
+    for (const value_set* layer : layers_) {
+      if (const string_v* values = layer->get(opt)) {
+        if (index < values->size())
+          return (*values)[index];
+        index -= values->size();
+        set = true;
+      }
+    }
+    if (set)
+      throw std::out_of_range("option '" + opt->key() + "' has fewer values");
+  }
+  if (index == 0 && opt->has_default_value())
+    return opt->default_value();
+  throw option_error("option '" + opt->key() + "' not set and without default");
+}
+
+value_section::value_section(const value_set& values, option_set& options, const std::string& section)
+    : values_(values)
+    , options_(options)
+    , prefix_(section)
+{
+  if (!prefix_.empty() && prefix_.back() != '.')
+    prefix_ += '.';
+  const std::pair<option_set::keyed_iterator, option_set::keyed_iterator> range = options_.find_prefix(prefix_);
+  begin_ = range.first;
+  end_ = range.second;
+}
+
+option_cx value_section::find(const std::string& key) const
+{
+  const size_t skip = prefix_.size();
+  const option_set::keyed_iterator it =
+      std::lower_bound(begin_, end_, key, [skip](const option_set::keyed_option& k, const std::string& rk) { return k.first.compare(skip, std::string::npos, rk) < 0; });
+  if (it != end_ && it->first.compare(skip, std::string::npos, key) == 0)
+    return it->second;
+  return nullptr;
+}
+
+bool value_section::is_set(const std::string& key) const
+{
+  return get(key) != nullptr;
+}
+
+const string_v* value_section::get(const std::string& key) const
+{
+  if (option_cx opt = find(key))
+    return values_.get(opt);
+  return nullptr;
+}
+
+const std::string& value_section::value(const std::string& key, size_t index) const
+{
+  if (option_cx opt = find(key))
+    return values_.value(opt, index);
+  throw option_error("no such option '" + prefix_ + key + "'");
+}
+
+value_section value_section::section(const std::string& sub) const
+{
+  return value_section(values_, options_, prefix_ + sub);
+}
+
+value_section::const_iterator::const_iterator(const value_section& section, option_set::keyed_iterator it)
+    : section_(&section)
+    , it_(it)
+{
+  skip_unset();
+}
+
+value_section::const_iterator& value_section::const_iterator::operator++()
+{
+  ++it_;
+  skip_unset();
+  return *this;
+}
+
+void value_section::const_iterator::skip_unset()
+{
+  for (; it_ != section_->end_; ++it_) {
+    if (const string_v* values = section_->values_.get(it_->second)) {
+      entry_.key = it_->first.c_str() + section_->prefix_.size();
+      entry_.opt = it_->second;
+      entry_.values = values;
+      return;
+    }
+  }
+}
+
+value_snapshot::value_snapshot()
+    : values_(std::make_shared<const value_set>())
+{
+}
+
+value_snapshot::value_snapshot(value_set values)
+    : values_(std::make_shared<const value_set>(std::move(values)))
+{
+}
+
+value_snapshot atomic_value_snapshot::load() const
+{
+  return value_snapshot(std::atomic_load(&snapshot_.values_));
+}
+
+void atomic_value_snapshot::store(const value_snapshot& snapshot)
+{
+  std::atomic_store(&snapshot_.values_, snapshot.values_);
+}
+
+value_snapshot_builder::value_snapshot_builder() {}
+
+value_snapshot_builder::value_snapshot_builder(const value_snapshot& base)
+    : base_(base)
+{
+}
+
+value_set& value_snapshot_builder::edit()
+{
+  if (!edited_)
+    edited_.reset(new value_set(*base_));
+  return *edited_;
+}
+
+value_snapshot_builder& value_snapshot_builder::put_implicit(option_cx opt)
+{
+  edit().put_implicit(opt);
+  return *this;
+}
+
+value_snapshot_builder& value_snapshot_builder::put(option_cx opt, const string_v& values)
+{
+  edit().put(opt, values);
+  return *this;
+}
+
+value_snapshot_builder& value_snapshot_builder::put(option_cx opt, const std::string& value)
+{
+  edit().put(opt, value);
+  return *this;
+}
+
+value_snapshot_builder& value_snapshot_builder::add(const value_set& other)
+{
+  edit().add(other);
+  return *this;
+}
+
+value_snapshot value_snapshot_builder::build()
+{
+  if (edited_) {
+    base_ = value_snapshot(std::move(*edited_));
+    edited_.reset();
+  }
+  return base_;
 }
 
 } // namespace program_options
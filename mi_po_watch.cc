@@ -0,0 +1,285 @@
+/*
+  mi-programoptions
+
+  Copyright (C) 2026 met.no
+
+  Contact information:
+  Norwegian Meteorological Institute
+  Box 43 Blindern
+  0313 OSLO
+  NORWAY
+  email: diana@met.no
+
+  This file is part of mi-programoptions.
+
+  mi-programoptions is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  mi-programoptions is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with mi-programoptions; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "mi_programoptions_watch.h"
+
+#include "mi_po_mmap.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#ifdef __linux__
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace miutil {
+namespace program_options {
+
+struct config_watcher::impl
+{
+  impl(const std::string& f, option_set& o, const config_settings& s)
+      : filename(f)
+      , options(o)
+      , settings(config_settings(s).set_memory_map(false))
+      , stopping(false)
+#ifdef __linux__
+      , inotify_fd(-1)
+#endif
+      , last_size(0)
+      , last_mtime(0)
+  {
+  }
+
+  bool reload();
+  void run();
+#ifdef __linux__
+  bool open_inotify();
+  bool watch_inotify();
+#endif
+  void watch_stamp();
+
+  const std::string filename;
+  option_set& options;
+  //! never memory mapped, the watched file may be truncated by a writer during a parse
+  const config_settings settings;
+
+  atomic_value_snapshot values;
+
+  change_handler on_change;
+  error_handler on_error;
+
+  //! serializes reload()
+  std::mutex reload_mutex;
+
+  std::thread thread;
+  std::mutex stop_mutex;
+  std::condition_variable stop_cv;
+  bool stopping;
+#ifdef __linux__
+  int stop_pipe[2];
+  int inotify_fd;
+#endif
+  uint64_t last_size;
+  int64_t last_mtime;
+};
+
+#ifdef __linux__
+
+bool config_watcher::impl::open_inotify()
+{
+  // watch the directory, editors often replace the file by renaming a new one; a
+  // created file is reported again by IN_CLOSE_WRITE when its content is written
+  const std::string::size_type slash = filename.rfind('/');
+  const std::string dir = (slash == std::string::npos) ? "." : (slash == 0 ? "/" : filename.substr(0, slash));
+
+  inotify_fd = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+  if (inotify_fd < 0)
+    return false;
+  if (::inotify_add_watch(inotify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    ::close(inotify_fd);
+    inotify_fd = -1;
+    return false;
+  }
+  return true;
+}
+
+//! \return false if inotify fails, after reporting this to on_error
+bool config_watcher::impl::watch_inotify()
+{
+  const std::string::size_type slash = filename.rfind('/');
+  const std::string base = (slash == std::string::npos) ? filename : filename.substr(slash + 1);
+
+  alignas(struct inotify_event) char buffer[16 * (sizeof(struct inotify_event) + NAME_MAX + 1)];
+  while (true) {
+    struct pollfd fds[2] = {{inotify_fd, POLLIN, 0}, {stop_pipe[0], POLLIN, 0}};
+    if (::poll(fds, 2, -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      if (on_error)
+        on_error("cannot watch '" + filename + "': " + std::strerror(errno) + ", checking every second instead");
+      return false;
+    }
+    if (fds[1].revents)
+      return true;
+
+    bool changed = false;
+    ssize_t n;
+    while ((n = ::read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+      for (const char* p = buffer; p < buffer + n;) {
+        const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(p);
+        if (event->len > 0 && base == event->name)
+          changed = true;
+        p += sizeof(struct inotify_event) + event->len;
+      }
+    }
+    if (changed)
+      reload();
+  }
+}
+
+#endif // __linux__
+
+void config_watcher::impl::watch_stamp()
+{
+  uint64_t size = 0;
+  int64_t mtime = 0;
+
+  std::unique_lock<std::mutex> lock(stop_mutex);
+  while (!stop_cv.wait_for(lock, std::chrono::seconds(1), [this] { return stopping; })) {
+    if (detail::file_stamp(filename, size, mtime) && (size != last_size || mtime != last_mtime)) {
+      last_size = size;
+      last_mtime = mtime;
+      lock.unlock();
+      reload();
+      lock.lock();
+    }
+  }
+}
+
+bool config_watcher::impl::reload()
+{
+  std::lock_guard<std::mutex> lock(reload_mutex);
+
+  value_set parsed;
+  try {
+    parsed = parse_config_file(filename, options, settings);
+  } catch (option_error& e) {
+    if (on_error)
+      on_error(e.what());
+    return false;
+  }
+
+  const snapshot_t previous = values.load();
+  const std::vector<option_cx> changed = changed_options(options, *previous, parsed);
+  if (changed.empty())
+    return false;
+
+  const snapshot_t next(std::move(parsed));
+  values.store(next);
+  if (on_change)
+    on_change(next, changed);
+  return true;
+}
+
+void config_watcher::impl::run()
+{
+#ifdef __linux__
+  if (inotify_fd >= 0) {
+    if (watch_inotify())
+      return;
+    // changes may have been missed while inotify failed
+    detail::file_stamp(filename, last_size, last_mtime);
+    reload();
+  }
+#endif
+  watch_stamp();
+}
+
+config_watcher::config_watcher(const std::string& filename, option_set& options, const config_settings& settings)
+    : p_(new impl(filename, options, settings))
+{
+  options.freeze();
+  p_->values.store(value_snapshot(parse_config_file(filename, options, p_->settings)));
+}
+
+config_watcher::~config_watcher()
+{
+  stop();
+}
+
+config_watcher::snapshot_t config_watcher::values() const
+{
+  return p_->values.load();
+}
+
+config_watcher& config_watcher::on_change(const change_handler& handler)
+{
+  p_->on_change = handler;
+  return *this;
+}
+
+config_watcher& config_watcher::on_error(const error_handler& handler)
+{
+  p_->on_error = handler;
+  return *this;
+}
+
+void config_watcher::start()
+{
+  if (p_->thread.joinable())
+    return;
+  p_->stopping = false;
+#ifdef __linux__
+  if (::pipe2(p_->stop_pipe, O_CLOEXEC) != 0)
+    throw option_error("cannot watch '" + p_->filename + "': " + std::strerror(errno));
+  if (!p_->open_inotify())
+#endif
+    detail::file_stamp(p_->filename, p_->last_size, p_->last_mtime);
+  p_->thread = std::thread(&impl::run, p_.get());
+}
+
+void config_watcher::stop()
+{
+  if (!p_->thread.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(p_->stop_mutex);
+    p_->stopping = true;
+  }
+  p_->stop_cv.notify_all();
+#ifdef __linux__
+  const char c = 0;
+  while (::write(p_->stop_pipe[1], &c, 1) < 0 && errno == EINTR)
+    ;
+#endif
+  p_->thread.join();
+#ifdef __linux__
+  ::close(p_->stop_pipe[0]);
+  ::close(p_->stop_pipe[1]);
+  if (p_->inotify_fd >= 0)
+    ::close(p_->inotify_fd);
+  p_->inotify_fd = -1;
+#endif
+}
+
+bool config_watcher::reload()
+{
+  return p_->reload();
+}
+
+} // namespace program_options
+} // namespace miutil
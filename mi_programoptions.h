@@ -30,10 +30,20 @@
 #ifndef MI_PROGRAMOPTIONS_H
 #define MI_PROGRAMOPTIONS_H
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <iosfwd>
+#include <iterator>
 #include <map>
+#include <memory>
 #include <regex>
 #include <string>
+#include <typeinfo>
+#include <unordered_map>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
 #include <vector>
 
 namespace miutil {
@@ -48,6 +58,7 @@ struct option_error : public std::runtime_error
 };
 
 class option;
+class option_set;
 typedef option* option_x;
 typedef const option* option_cx;
 
@@ -93,11 +104,44 @@ public:
   option& set_narg(size_t n);
   size_t narg() const;
 
+  //! dense number assigned when first added to an option_set, or NO_ORDINAL
+  size_t ordinal() const;
+  static const size_t NO_ORDINAL = static_cast<size_t>(-1);
+
+private:
+  friend class option_set;
+  void set_ordinal(size_t ordinal) const;
+  const std::string& key_line() const;
+
+  //! keys, help, default and implicit value, shared by copies; edit() copies it if shared
+  struct text;
+  text& edit();
+
+  enum {
+    COMPOSING = 1 << 0,
+    OVERWRITING = 1 << 1,
+    HAS_DEFAULT = 1 << 2,
+    HAS_IMPLICIT = 1 << 3,
+  };
+
 private:
-  struct d;
-  std::unique_ptr<d> d_;
+  std::shared_ptr<text> text_;
+  size_t narg_;
+  mutable size_t ordinal_;
+  unsigned char flags_;
 };
 
+bool convert_value(const char* begin, const char* end, int& value);
+bool convert_value(const char* begin, const char* end, long& value);
+bool convert_value(const char* begin, const char* end, long long& value);
+bool convert_value(const char* begin, const char* end, unsigned int& value);
+bool convert_value(const char* begin, const char* end, unsigned long& value);
+bool convert_value(const char* begin, const char* end, unsigned long long& value);
+bool convert_value(const char* begin, const char* end, float& value);
+bool convert_value(const char* begin, const char* end, double& value);
+bool convert_value(const char* begin, const char* end, bool& value);
+bool convert_value(const char* begin, const char* end, std::string& value);
+
 class value_set
 {
 public:
@@ -112,36 +156,493 @@ public:
   const std::string& value(option_cx opt, size_t index = 0) const;
   const std::string& value(const option& opt, size_t index = 0) const { return value(&opt, index); }
 
+  //! values converted with convert_value, cached until the option is changed; may be called concurrently on a const value_set
+  template <class T>
+  const std::vector<T>& values_as(option_cx opt) const;
+  template <class T>
+  const std::vector<T>& values_as(const option& opt) const { return values_as<T>(&opt); }
+
+  //! like value, but converted with convert_value; the default value is not cached
+  template <class T>
+  T value_as(option_cx opt, size_t index = 0) const;
+  template <class T>
+  T value_as(const option& opt, size_t index = 0) const { return value_as<T>(&opt, index); }
+
   option_cx find(const std::string& key, bool use_shortkey = false) const;
 
   void put_implicit(option_cx opt);
   void put(option_cx opt, const string_v& values);
-  void put(option_cx opt, const std::string& value) { put(opt, string_v(1, value)); }
+  void put(option_cx opt, string_v&& values);
+  void put(option_cx opt, const std::string& value);
+  void put(option_cx opt, std::string&& value);
+
+  //! like put with a single value, constructed in place from [begin, end)
+  void emplace(option_cx opt, const char* begin, const char* end);
 
   void add(const value_set& other);
 
+  //! like add, but moves the values out of other
+  void add(value_set&& other);
+
+  //! remove the values of opt
+  void erase(option_cx opt);
+
 private:
-  typedef std::map<option_cx, string_v> values_t;
+  //! values_as cache entry for one type
+  struct conversion
+  {
+    virtual ~conversion();
+    const std::type_info* type;
+    const conversion* next;
+  };
+  template <class T>
+  struct conversion_of : conversion
+  {
+    std::vector<T> values;
+  };
+
+  struct slot
+  {
+    slot();
+    slot(const slot& other);
+    slot(slot&& other) noexcept;
+    slot& operator=(const slot& other);
+    ~slot();
+
+    void clear_converted();
+
+    option_cx opt; //!< nullptr if not set
+    string_v values;
+
+    //! list of conversions, prepended lock-free by values_as
+    mutable std::atomic<const conversion*> converted;
+  };
+
+  slot& insert(option_cx opt);
+  slot& put_slot(option_cx opt, size_t count);
+  const slot* find_slot(option_cx opt) const;
+  const slot& set_slot(option_cx opt) const;
+  [[noreturn]] static void throw_convert_error(option_cx opt, const std::string& text);
+
+  template <class T>
+  static T convert(option_cx opt, const std::string& text);
+
+private:
+  //! values indexed by option ordinal
+  typedef std::vector<slot> slots_t;
+  slots_t slots_;
+
+  //! values for options without ordinal, or with an ordinal used by another option
+  typedef std::map<option_cx, slot> values_t;
   values_t values_;
 };
 
-class option_set
+template <class T>
+T value_set::convert(option_cx opt, const std::string& text)
+{
+  T value;
+  if (!convert_value(text.data(), text.data() + text.size(), value))
+    throw_convert_error(opt, text);
+  return value;
+}
+
+template <class T>
+const std::vector<T>& value_set::values_as(option_cx opt) const
+{
+  const slot& s = set_slot(opt);
+  const conversion* head = s.converted.load(std::memory_order_acquire);
+  for (const conversion* c = head; c; c = c->next) {
+    if (*c->type == typeid(T))
+      return static_cast<const conversion_of<T>*>(c)->values;
+  }
+
+  std::unique_ptr<conversion_of<T>> converted(new conversion_of<T>);
+  converted->type = &typeid(T);
+  converted->values.reserve(s.values.size());
+  for (const std::string& text : s.values)
+    converted->values.push_back(convert<T>(opt, text));
+
+  // concurrent calls may both add a conversion for T, the list keeps both
+  converted->next = head;
+  while (!s.converted.compare_exchange_weak(converted->next, converted.get(), std::memory_order_acq_rel, std::memory_order_acquire))
+    ;
+  return converted.release()->values;
+}
+
+template <class T>
+T value_set::value_as(option_cx opt, size_t index) const
+{
+  if (is_set(opt))
+    return values_as<T>(opt).at(index);
+  return convert<T>(opt, value(opt, index));
+}
+
+/*!
+ * Lookup through several value_sets, e.g. defaults, config files,
+ * environment and command line, each layer taking precedence over the
+ * layers added before it.
+ *
+ * Non-composing options have the values from the top-most layer that
+ * sets them. Composing options have the values from all layers, bottom
+ * layer first. Values are not copied; the layers must outlive this.
+ */
+class layered_values
+{
+public:
+  //! add a layer on top
+  layered_values& push(const value_set& layer);
+  layered_values& operator<<(const value_set& layer) { return push(layer); }
+  size_t layers() const { return layers_.size(); }
+
+  bool is_set(option_cx opt) const { return top_layer(opt) != nullptr; }
+  bool is_set(const option& opt) const { return is_set(&opt); }
+
+  //! \return the top-most layer that sets opt, or nullptr
+  const value_set* top_layer(option_cx opt) const;
+
+  //! number of values of opt, without the default value
+  size_t count(option_cx opt) const;
+  size_t count(const option& opt) const { return count(&opt); }
+
+  //! like value_set::value, counting composing values across layers
+  const std::string& value(option_cx opt, size_t index = 0) const;
+  const std::string& value(const option& opt, size_t index = 0) const { return value(&opt, index); }
+
+  //! call f with each value of opt
+  template <class F>
+  void for_each(option_cx opt, F f) const;
+
+private:
+  std::vector<const value_set*> layers_;
+};
+
+template <class F>
+void layered_values::for_each(option_cx opt, F f) const
+{
+  if (!opt)
+    throw option_error("option is null");
+  if (!opt->is_composing()) {
+    if (const value_set* layer = top_layer(opt)) {
+      for (const std::string& v : *layer->get(opt))
+        f(v);
+    }
+    return;
+  }
+  for (const value_set* layer : layers_) {
+    if (const string_v* values = layer->get(opt)) {
+      for (const std::string& v : *values)
+        f(v);
+    }
+  }
+}
+
+//! \return options that are set in only one of a and b, or set to different values
+std::vector<option_cx> changed_options(const option_set& options, const value_set& a, const value_set& b);
+
+/*!
+ * Immutable value_set that may be shared between threads.
+ *
+ * All lookups are const and do not lock. Copies share the same values.
+ */
+class value_snapshot
 {
 public:
-  option_set& add(const option& option)
+  //! empty values
+  value_snapshot();
+  explicit value_snapshot(value_set values);
+
+  const value_set& operator*() const { return *values_; }
+  const value_set* operator->() const { return values_.get(); }
+
+  bool operator==(const value_snapshot& other) const { return values_ == other.values_; }
+  bool operator!=(const value_snapshot& other) const { return values_ != other.values_; }
+
+private:
+  friend class atomic_value_snapshot;
+  explicit value_snapshot(const std::shared_ptr<const value_set>& values)
+      : values_(values)
   {
-    options_.push_back(&option);
-    return *this;
   }
+
+private:
+  std::shared_ptr<const value_set> values_;
+};
+
+/*!
+ * value_snapshot that may be replaced by one thread while others load it.
+ *
+ * load and store use std::atomic_load/atomic_store for shared_ptr, which
+ * are not lock-free with common standard libraries (libstdc++ uses a
+ * small pool of mutexes), so load may wait briefly for a store. Lookups
+ * in a loaded snapshot never wait.
+ */
+class atomic_value_snapshot
+{
+public:
+  atomic_value_snapshot() {}
+  explicit atomic_value_snapshot(const value_snapshot& snapshot)
+      : snapshot_(snapshot)
+  {
+  }
+
+  value_snapshot load() const;
+  void store(const value_snapshot& snapshot);
+
+private:
+  atomic_value_snapshot(const atomic_value_snapshot&);
+  atomic_value_snapshot& operator=(const atomic_value_snapshot&);
+
+  value_snapshot snapshot_;
+};
+
+/*!
+ * Builds a new value_snapshot from an existing one.
+ *
+ * The values of the base snapshot are copied at the first change, so
+ * build() without changes returns the base snapshot itself.
+ */
+class value_snapshot_builder
+{
+public:
+  value_snapshot_builder();
+  explicit value_snapshot_builder(const value_snapshot& base);
+
+  value_snapshot_builder& put_implicit(option_cx opt);
+  value_snapshot_builder& put(option_cx opt, const string_v& values);
+  value_snapshot_builder& put(option_cx opt, const std::string& value);
+  value_snapshot_builder& add(const value_set& other);
+
+  //! \return the new snapshot, which is also the base for further changes
+  value_snapshot build();
+
+private:
+  value_set& edit();
+
+private:
+  value_snapshot base_;
+  std::unique_ptr<value_set> edited_;
+};
+
+//! key lookup for option_set, e.g. static_option_set from mi_programoptions_static.h
+class option_index
+{
+public:
+  virtual ~option_index();
+
+  //! \return the option with this key, or nullptr
+  virtual option_cx find(const std::string& key, bool use_shortkey) const = 0;
+};
+
+//! character range [begin, end), not nul-terminated
+struct value_range
+{
+  const char* begin;
+  const char* end;
+};
+
+/*!
+ * Receives values from the parsers instead of a value_set, see
+ * pmr::value_set in mi_programoptions_pmr.h.
+ *
+ * The character ranges point into the parser's input and are only
+ * valid during the call.
+ */
+class value_receiver
+{
+public:
+  virtual ~value_receiver();
+
+  virtual void put_implicit(option_cx opt) = 0;
+  virtual void put(option_cx opt, const value_range* values, size_t count) = 0;
+  virtual void put_positional(const value_range& arg) = 0;
+};
+
+//! where a parser found a value
+struct source_location
+{
+  enum kind_t { CONFIG_FILE, COMMAND_LINE };
+  kind_t kind;
+  const char* filename; //!< config file name, nullptr for streams and the command line
+  int position;         //!< config file line, starting at 1, or index in argv
+};
+
+/*!
+ * Receives each value as it is parsed, without building a value_set.
+ *
+ * Options with an implicit value are visited with that value. The
+ * character ranges and the location are only valid during the call.
+ */
+class option_visitor
+{
+public:
+  virtual ~option_visitor();
+
+  virtual void visit(option_cx opt, const value_range* values, size_t count, const source_location& where) = 0;
+
+  //! positional argument from parse_command_line; ignored by default
+  virtual void visit_positional(const value_range& arg, const source_location& where);
+};
+
+//! counters filled in by the parsers and find_option, see option_set::set_stats
+struct parse_stats
+{
+  parse_stats();
+
+  uint64_t lines;         //!< config file lines
+  uint64_t arguments;     //!< command line arguments
+  uint64_t bytes;         //!< config file bytes
+  uint64_t values;        //!< option values stored; not an allocation count, short and empty values need none
+  uint64_t lookups;       //!< find_option calls
+  uint64_t lookup_misses; //!< find_option calls not answered by an index
+
+  uint64_t read_ns;         //!< wall time opening, mapping and reading config files
+  uint64_t config_ns;       //!< wall time lexing config files and storing values
+  uint64_t command_line_ns; //!< wall time parsing command lines
+};
+
+class option_set
+{
+public:
+  option_set();
+
+  option_set& add(const option& option);
   option_set& operator<<(const option& option) { return add(option); }
 
+  typedef std::vector<option_cx>::const_iterator const_iterator;
+  const_iterator begin() const { return options_.begin(); }
+  const_iterator end() const { return options_.end(); }
+
+  /*!
+   * Find an option by key through a hash index. If several options have
+   * the same key, the first one added is returned.
+   *
+   * Keys should not be changed after adding an option. If they are, call
+   * freeze() afterwards; without it, a new key is still found, but not
+   * necessarily in the first option that has it.
+   */
   option_cx find_option(const std::string& key, bool use_shortkey = false);
 
+  //! build the key index now instead of at the first find_option, again after changing keys
+  void freeze();
+
+  //! ask index before searching the options in this set; index must outlive this set
+  option_set& set_index(const option_index* index);
+
+  typedef std::pair<std::string, option_cx> keyed_option;
+  typedef std::vector<keyed_option>::const_iterator keyed_iterator;
+
+  //! options with a long key starting with prefix, sorted by key; invalid after add
+  std::pair<keyed_iterator, keyed_iterator> find_prefix(const std::string& prefix);
+
   void dump(std::ostream& out, const value_set& values) const;
   void help(std::ostream& out) const;
 
+  //! help with keys and wrapped help texts in two columns, for a terminal with width columns
+  void help(std::ostream& out, size_t width) const;
+
+  //! count parser work in stats, which must outlive this set; nullptr to stop
+  option_set& set_stats(parse_stats* stats);
+  parse_stats* stats() const { return stats_; }
+  void dump_stats(std::ostream& out) const;
+
+  /*!
+   * Replace command line arguments "@file" by the whitespace separated,
+   * possibly quoted arguments in file, which may name further response files.
+   * Off by default.
+   */
+  option_set& set_response_files(bool enable)
+  {
+    response_files_ = enable;
+    return *this;
+  }
+  bool response_files() const { return response_files_; }
+
+private:
+  void index_option(option_cx opt);
+
 private:
   std::vector<option_cx> options_;
+
+  const option_index* external_index_;
+
+  typedef std::unordered_map<std::string, option_cx> key_index_t;
+  bool indexed_;
+  key_index_t keys_;
+  key_index_t shortkeys_;
+
+  bool sorted_;
+  std::vector<keyed_option> sorted_keys_;
+
+  parse_stats* stats_;
+  bool response_files_;
+};
+
+/*!
+ * The options in a config file section, e.g. "model.ensemble", with keys
+ * relative to the section.
+ *
+ * Values are not copied. The view is valid until values or options are
+ * changed.
+ */
+class value_section
+{
+public:
+  value_section(const value_set& values, option_set& options, const std::string& section);
+
+  //! an option in the section that is set
+  struct entry
+  {
+    const char* key; //!< relative to the section
+    option_cx opt;
+    const string_v* values;
+  };
+
+  class const_iterator
+  {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef entry value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const entry* pointer;
+    typedef const entry& reference;
+
+    const_iterator(const value_section& section, option_set::keyed_iterator it);
+
+    const entry& operator*() const { return entry_; }
+    const entry* operator->() const { return &entry_; }
+    const_iterator& operator++();
+    bool operator==(const const_iterator& other) const { return it_ == other.it_; }
+    bool operator!=(const const_iterator& other) const { return it_ != other.it_; }
+
+  private:
+    void skip_unset();
+
+  private:
+    const value_section* section_;
+    option_set::keyed_iterator it_;
+    entry entry_;
+  };
+
+  const_iterator begin() const { return const_iterator(*this, begin_); }
+  const_iterator end() const { return const_iterator(*this, end_); }
+
+  //! section name with a trailing '.'
+  const std::string& prefix() const { return prefix_; }
+
+  //! \return the option with this relative key, or nullptr
+  option_cx find(const std::string& key) const;
+
+  bool is_set(const std::string& key) const;
+  const string_v* get(const std::string& key) const;
+  const std::string& value(const std::string& key, size_t index = 0) const;
+
+  value_section section(const std::string& sub) const;
+
+private:
+  const value_set& values_;
+  option_set& options_;
+  std::string prefix_;
+  option_set::keyed_iterator begin_, end_;
 };
 
 class positional_args_consumer
@@ -149,6 +650,11 @@ class positional_args_consumer
 public:
   positional_args_consumer(value_set& vm, const string_v& pa) : values_(vm), positional_(pa), pbegin_(positional_.begin()) {}
 
+  //! take the positional arguments and move them into vm instead of copying them
+  positional_args_consumer(value_set& vm, string_v&& pa);
+
+  positional_args_consumer(const positional_args_consumer& other);
+
   positional_args_consumer& operator>>(const option& opt);
   string_v::const_iterator begin() const { return pbegin_; }
   string_v::const_iterator end() const { return positional_.end(); }
@@ -156,18 +662,161 @@ public:
 
   void dump(std::ostream& out) const;
 
+private:
+  bool owns_positional() const { return &positional_ == &owned_; }
+
 private:
   value_set& values_;
+  string_v owned_;
   const string_v& positional_;
   string_v::const_iterator pbegin_;
 };
 
+/*!
+ * Receives the positional arguments from parse_command_line one at a time,
+ * e.g. to process long lists of files without keeping them all in memory.
+ */
+class positional_sink
+{
+public:
+  virtual ~positional_sink();
+
+  virtual void put_positional(std::string&& arg) = 0;
+};
+
+//! optional settings for parse_config_file
+class config_settings
+{
+public:
+  config_settings();
+
+  //! lex chunks of large config files with n threads, 0 for one per core; default 1
+  config_settings& set_threads(size_t n);
+  size_t threads() const { return threads_; }
+
+  //! load values from this cache file if it is valid, else parse and write it; default none
+  config_settings& set_cache_file(const std::string& cache_file);
+  const std::string& cache_file() const { return cache_file_; }
+
+  /*!
+   * Parse regular files from a memory map instead of reading them; default off.
+   *
+   * Only for files that are not truncated while parsing, as this
+   * kills the process with SIGBUS.
+   */
+  config_settings& set_memory_map(bool enable);
+  bool memory_map() const { return memory_map_; }
+
+private:
+  size_t threads_;
+  std::string cache_file_;
+  bool memory_map_;
+};
+
+//! save values as binary cache, valid for options and the current size and mtime of source_file
+void save_value_cache(const std::string& cache_file, const value_set& values, const option_set& options, const std::string& source_file);
+
+//! \return false if cache_file is missing, or not valid for options and source_file
+bool load_value_cache(const std::string& cache_file, option_set& options, const std::string& source_file, value_set& values);
+
 value_set parse_config_file(const std::string& filename, option_set& options);
 value_set parse_config_file(std::istream& infile, option_set& options);
+value_set parse_config_file(const std::string& filename, option_set& options, const config_settings& settings);
+value_set parse_config_file(std::istream& infile, option_set& options, const config_settings& settings);
+void parse_config_file(const std::string& filename, option_set& options, value_receiver& values);
+void parse_config_file(std::istream& infile, option_set& options, value_receiver& values);
+void parse_config_file(const std::string& filename, option_set& options, option_visitor& visitor);
+void parse_config_file(std::istream& infile, option_set& options, option_visitor& visitor);
+
+/*!
+ * Parses a config file repeatedly, re-lexing only the [section]s whose
+ * content changed since the previous parse.
+ *
+ * The whole file is parsed if sections were added, removed or moved,
+ * or if an option from a changed section is also set in another
+ * section.
+ */
+class incremental_config_parser
+{
+public:
+  explicit incremental_config_parser(option_set& options);
+
+  //! \return options with changed values; if parsing fails, values() is not changed
+  std::vector<option_cx> parse(const std::string& filename);
+  std::vector<option_cx> parse(std::istream& infile);
+
+  const value_set& values() const { return values_; }
+
+  //! true if the last parse had to parse the whole file
+  bool was_full_parse() const { return full_parse_; }
+
+private:
+  //! text from a section line to the next, or from the start of the file to the first
+  struct segment
+  {
+    size_t begin, end; //!< byte range
+    uint64_t hash;
+    int first_line;
+    std::vector<option_cx> options; //!< options set in this segment
+  };
+  typedef std::vector<segment> segments_t;
+
+  std::vector<option_cx> parse_buffer(const char* begin, const char* end);
+
+private:
+  option_set& options_;
+  value_set values_;
+  segments_t segments_;
+  bool full_parse_;
+};
+
+//! \return name of the environment variable for an option key, without prefix
+typedef std::string (*environment_mapping)(const std::string& key);
+
+//! default environment_mapping, e.g. "model.steps" to "MODEL_STEPS"
+std::string environment_name(const std::string& key);
+
+/*!
+ * Set options from environment variables named prefix + mapping(key),
+ * e.g. APP_MODEL_STEPS for "model.steps" with prefix "APP_".
+ *
+ * An empty value sets options with an implicit value to that. Options
+ * with narg 0 are set by an empty value, other values throw like
+ * "--flag=value" on the command line. Options with narg > 1 take
+ * whitespace separated values.
+ */
+value_set parse_environment(option_set& options, const std::string& prefix, environment_mapping mapping = nullptr);
+
+//! like parse_environment above, but with env instead of environ; env ends with nullptr
+value_set parse_environment(option_set& options, const std::string& prefix, const char* const* env, environment_mapping mapping = nullptr);
+
+//! \return width of the terminal on stdout, or from $COLUMNS, or 80
+size_t terminal_width();
 
 value_set parse_command_line(const std::vector<std::string>& argv, option_set& options, std::vector<std::string>& positional);
 value_set parse_command_line(int argc, char* argv[], option_set& options, std::vector<std::string>& positional);
 
+//! like parse_command_line above, but positional arguments are passed to positional while parsing
+value_set parse_command_line(const std::vector<std::string>& argv, option_set& options, positional_sink& positional);
+value_set parse_command_line(int argc, char* argv[], option_set& options, positional_sink& positional);
+
+//! like parse_command_line above, but positional arguments point into argv; response files are not allowed
+value_set parse_command_line(int argc, const char* const argv[], option_set& options, std::vector<const char*>& positional);
+
+//! receivers like pmr::value_set keep views into argv, so response files are not allowed
+void parse_command_line(int argc, const char* const argv[], option_set& options, value_receiver& values);
+void parse_command_line(int argc, const char* const argv[], option_set& options, option_visitor& visitor);
+
+#if __cplusplus >= 201703L
+inline value_set parse_command_line(int argc, const char* const argv[], option_set& options, std::vector<std::string_view>& positional)
+{
+  std::vector<const char*> pa;
+  value_set values = parse_command_line(argc, argv, options, pa);
+  positional.insert(positional.end(), pa.begin(), pa.end());
+  return values;
+}
+#endif
+
 } // namespace program_options
 } // namespace miutil
 
@@ -0,0 +1,241 @@
+/*
+  mi-programoptions
+
+  Copyright (C) 2026 met.no
+
+  Contact information:
+  Norwegian Meteorological Institute
+  Box 43 Blindern
+  0313 OSLO
+  NORWAY
+  email: diana@met.no
+
+  This file is part of mi-programoptions.
+
+  mi-programoptions is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  mi-programoptions is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with mi-programoptions; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef MI_PROGRAMOPTIONS_PMR_H
+#define MI_PROGRAMOPTIONS_PMR_H
+
+// value_set with a std::pmr::memory_resource, requires C++17.
+//
+//   std::pmr::monotonic_buffer_resource arena;
+//   pmr::value_set values = pmr::parse_config_file(infile, options, &arena);
+
+#if __cplusplus < 201703L
+#error "mi_programoptions_pmr.h requires C++17"
+#endif
+
+#include "mi_programoptions.h"
+
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace miutil {
+namespace program_options {
+namespace pmr {
+
+typedef std::pmr::vector<std::pmr::string> string_v;
+
+/*!
+ * Like program_options::value_set, but all values are allocated from a
+ * memory resource.
+ *
+ * Positional arguments from parse_command_line are kept as views into
+ * argv.
+ */
+class value_set : public value_receiver
+{
+public:
+  explicit value_set(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : slot_options_(resource)
+      , slot_values_(resource)
+      , values_(resource)
+      , positional_(resource)
+  {
+  }
+
+  std::pmr::memory_resource* resource() const { return slot_options_.get_allocator().resource(); }
+
+  bool is_set(option_cx opt) const { return opt && get(opt); }
+  bool is_set(const option& opt) const { return is_set(&opt); }
+
+  const string_v* get(option_cx opt) const
+  {
+    if (!opt)
+      throw option_error("option is null");
+    const size_t ordinal = opt->ordinal();
+    if (ordinal < slot_options_.size() && slot_options_[ordinal] == opt)
+      return &slot_values_[ordinal];
+    if (!values_.empty()) {
+      const auto it = values_.find(opt);
+      if (it != values_.end())
+        return &it->second;
+    }
+    return nullptr;
+  }
+  const string_v* get(const option& opt) const { return get(&opt); }
+
+  const string_v& values(option_cx opt) const
+  {
+    if (const string_v* values = get(opt))
+      return *values;
+    throw option_error("option '" + opt->key() + "' not set and without default");
+  }
+  const string_v& values(const option& opt) const { return values(&opt); }
+
+  std::string_view value(option_cx opt, size_t index = 0) const
+  {
+    if (const string_v* values = get(opt))
+      return values->at(index);
+    if (index == 0 && opt->has_default_value())
+      return opt->default_value();
+    throw option_error("option '" + opt->key() + "' not set and without default");
+  }
+  std::string_view value(const option& opt, size_t index = 0) const { return value(&opt, index); }
+
+  option_cx find(std::string_view key, bool use_shortkey = false) const
+  {
+    for (option_cx opt : slot_options_) {
+      if (opt && match_first(opt, key, use_shortkey))
+        return opt;
+    }
+    for (const auto& o : values_) {
+      if (match_first(o.first, key, use_shortkey))
+        return o.first;
+    }
+    return nullptr;
+  }
+
+  const std::pmr::vector<std::string_view>& positional() const { return positional_; }
+
+  void put_implicit(option_cx opt) override
+  {
+    if (!opt)
+      throw option_error("option is null");
+    if (!opt->has_implicit_value())
+      throw option_error("option '" + opt->key() + "' does not have an implicit value");
+    if (opt->narg() != 1)
+      throw option_error("option '" + opt->key() + "' expects != 1 values, cannot set to implicit value");
+    put(opt, opt->implicit_value());
+  }
+
+  void put(option_cx opt, std::string_view value)
+  {
+    const value_range v = {value.data(), value.data() + value.size()};
+    put(opt, &v, 1);
+  }
+
+  void put(option_cx opt, const value_range* values, size_t count) override
+  {
+    if (!opt)
+      throw option_error("option is null");
+    if (opt->is_composing()) {
+      if (count != 1)
+        throw option_error("option '" + opt->key() + "' is composing, cannot #values != 1");
+    } else {
+      if (is_set(opt) && !opt->is_overwriting())
+        throw option_error("option '" + opt->key() + "' already set and not composing or overwriting");
+    }
+
+    string_v& v = insert(opt);
+    if (opt->is_overwriting())
+      v.clear();
+    for (size_t i = 0; i < count; ++i)
+      v.emplace_back(values[i].begin, values[i].end);
+  }
+
+  void put_positional(const value_range& arg) override { positional_.emplace_back(arg.begin, arg.end - arg.begin); }
+
+  void add(const value_set& other)
+  {
+    for (size_t i = 0; i < other.slot_options_.size(); ++i) {
+      if (option_cx opt = other.slot_options_[i])
+        add(opt, other.slot_values_[i]);
+    }
+    for (const auto& o : other.values_)
+      add(o.first, o.second);
+  }
+
+private:
+  static bool match_first(option_cx opt, std::string_view key, bool use_shortkey)
+  {
+    const std::string& k = use_shortkey ? opt->shortkey() : opt->key();
+    return !k.empty() && k == key;
+  }
+
+  string_v& insert(option_cx opt)
+  {
+    const size_t ordinal = opt->ordinal();
+    if (ordinal != option::NO_ORDINAL) {
+      if (ordinal >= slot_options_.size()) {
+        slot_options_.resize(ordinal + 1, nullptr);
+        slot_values_.resize(ordinal + 1);
+      }
+      if (!slot_options_[ordinal])
+        slot_options_[ordinal] = opt;
+      if (slot_options_[ordinal] == opt)
+        return slot_values_[ordinal];
+    }
+    return values_[opt];
+  }
+
+  void add(option_cx opt, const string_v& values)
+  {
+    if (is_set(opt))
+      throw option_error("option '" + opt->key() + "' already set");
+    insert(opt) = values;
+  }
+
+private:
+  //! values indexed by option ordinal, see program_options::value_set
+  std::pmr::vector<option_cx> slot_options_;
+  std::pmr::vector<string_v> slot_values_;
+
+  std::pmr::map<option_cx, string_v> values_;
+
+  std::pmr::vector<std::string_view> positional_;
+};
+
+inline value_set parse_config_file(const std::string& filename, option_set& options, std::pmr::memory_resource* resource)
+{
+  value_set values(resource);
+  program_options::parse_config_file(filename, options, values);
+  return values;
+}
+
+inline value_set parse_config_file(std::istream& infile, option_set& options, std::pmr::memory_resource* resource)
+{
+  value_set values(resource);
+  program_options::parse_config_file(infile, options, values);
+  return values;
+}
+
+inline value_set parse_command_line(int argc, const char* const argv[], option_set& options, std::pmr::memory_resource* resource)
+{
+  value_set values(resource);
+  program_options::parse_command_line(argc, argv, options, values);
+  return values;
+}
+
+} // namespace pmr
+} // namespace program_options
+} // namespace miutil
+
+#endif // MI_PROGRAMOPTIONS_PMR_H
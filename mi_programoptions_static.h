@@ -0,0 +1,339 @@
+/*
+  mi-programoptions
+
+  Copyright (C) 2026 met.no
+
+  Contact information:
+  Norwegian Meteorological Institute
+  Box 43 Blindern
+  0313 OSLO
+  NORWAY
+  email: diana@met.no
+
+  This file is part of mi-programoptions.
+
+  mi-programoptions is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  mi-programoptions is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with mi-programoptions; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef MI_PROGRAMOPTIONS_STATIC_H
+#define MI_PROGRAMOPTIONS_STATIC_H
+
+// Option tables known at compile time, requires C++17.
+//
+//   constexpr option_spec specs[] = {
+//     option_spec("help", "show help").set_shortkey("h").set_narg(0),
+//     option_spec("model.steps", "number of steps").set_default_value("10"),
+//   };
+//   constexpr static_option_table table(specs);
+//   constexpr size_t HELP = table.find("help");
+//
+//   static_option_set options(table);
+//   value_set values = parse_command_line(argc, argv, options.options(), positional);
+//   if (values.is_set(options[HELP])) ...
+
+#if __cplusplus < 201703L
+#error "mi_programoptions_static.h requires C++17"
+#endif
+
+#include "mi_programoptions.h"
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+namespace miutil {
+namespace program_options {
+
+//! compile time description of an option, see option
+struct option_spec
+{
+  constexpr option_spec(std::string_view k, std::string_view h)
+      : key(k)
+      , help(h)
+  {
+  }
+
+  constexpr option_spec set_shortkey(std::string_view sk) const
+  {
+    option_spec s = *this;
+    s.shortkey = sk;
+    return s;
+  }
+
+  constexpr option_spec set_default_value(std::string_view d) const
+  {
+    option_spec s = *this;
+    s.default_value = d;
+    s.has_default_value = true;
+    return s;
+  }
+
+  constexpr option_spec set_implicit_value(std::string_view i) const
+  {
+    option_spec s = *this;
+    s.implicit_value = i;
+    s.has_implicit_value = true;
+    return s;
+  }
+
+  constexpr option_spec set_composing() const
+  {
+    option_spec s = *this;
+    s.is_composing = true;
+    s.is_overwriting = false;
+    return s;
+  }
+
+  constexpr option_spec set_overwriting() const
+  {
+    option_spec s = *this;
+    s.is_composing = false;
+    s.is_overwriting = true;
+    return s;
+  }
+
+  constexpr option_spec set_narg(size_t n) const
+  {
+    option_spec s = *this;
+    s.narg = n;
+    return s;
+  }
+
+  std::string_view key;
+  std::string_view help;
+  std::string_view shortkey;
+  std::string_view default_value;
+  std::string_view implicit_value;
+  size_t narg = 1;
+  bool has_default_value = false;
+  bool has_implicit_value = false;
+  bool is_composing = false;
+  bool is_overwriting = false;
+};
+
+namespace detail {
+
+constexpr uint64_t spec_hash(std::string_view key, uint64_t seed)
+{
+  // FNV-1a with a seeded offset basis and a final mix
+  uint64_t h = 14695981039346656037ull ^ (seed * 0x9e3779b97f4a7c15ull);
+  for (char c : key) {
+    h ^= static_cast<unsigned char>(c);
+    h *= 1099511628211ull;
+  }
+  return h ^ (h >> 29);
+}
+
+constexpr size_t spec_hash_slots(size_t n)
+{
+  size_t s = 1;
+  while (s < 2 * n)
+    s *= 2;
+  return s;
+}
+
+/*!
+ * Perfect hash over the long or short keys of N option_specs, built
+ * with "hash and displace": keys are grouped into buckets by a first
+ * hash, then for each bucket, largest first, a seed is searched such
+ * that the second hash puts all keys of the bucket into free slots.
+ */
+template <size_t N>
+class spec_perfect_hash
+{
+public:
+  static constexpr size_t BUCKETS = N / 2 + 1;
+  static constexpr size_t SLOTS = spec_hash_slots(N);
+
+  constexpr spec_perfect_hash(const std::array<option_spec, N>& specs, bool use_shortkey)
+      : seeds_()
+      , slots_()
+  {
+    for (size_t s = 0; s < SLOTS; ++s)
+      slots_[s] = -1;
+
+    // sort the spec indices by bucket with a counting sort, keys are in
+    // members[offset[b] .. offset[b + 1]) for bucket b
+    std::array<size_t, N> bucket_of{};
+    std::array<size_t, BUCKETS + 1> offset{};
+    for (size_t i = 0; i < N; ++i) {
+      const std::string_view k = key(specs[i], use_shortkey);
+      bucket_of[i] = k.empty() ? BUCKETS : spec_hash(k, 0) % BUCKETS;
+      if (!k.empty())
+        offset[bucket_of[i] + 1] += 1;
+    }
+    for (size_t b = 0; b < BUCKETS; ++b)
+      offset[b + 1] += offset[b];
+    std::array<size_t, N> members{};
+    std::array<size_t, BUCKETS> fill{};
+    for (size_t i = 0; i < N; ++i) {
+      if (bucket_of[i] < BUCKETS)
+        members[offset[bucket_of[i]] + fill[bucket_of[i]]++] = i;
+    }
+
+    // order the buckets by size, largest first, again with a counting sort
+    std::array<size_t, N + 2> size_offset{};
+    for (size_t b = 0; b < BUCKETS; ++b)
+      size_offset[N - (offset[b + 1] - offset[b]) + 1] += 1;
+    for (size_t z = 0; z <= N; ++z)
+      size_offset[z + 1] += size_offset[z];
+    std::array<size_t, BUCKETS> by_size{};
+    for (size_t b = 0; b < BUCKETS; ++b)
+      by_size[size_offset[N - (offset[b + 1] - offset[b])]++] = b;
+
+    for (size_t round = 0; round < BUCKETS; ++round) {
+      const size_t b = by_size[round];
+      const size_t first = offset[b], last = offset[b + 1];
+      if (first == last)
+        break;
+
+      for (size_t m = first; m < last; ++m) {
+        for (size_t t = first; t < m; ++t) {
+          if (key(specs[members[t]], use_shortkey) == key(specs[members[m]], use_shortkey))
+            throw std::logic_error("duplicate option key");
+        }
+      }
+
+      // place the keys one by one, and take them out again if one does not fit
+      for (uint32_t seed = 1;; ++seed) {
+        size_t m = first;
+        for (; m < last; ++m) {
+          const size_t slot = spec_hash(key(specs[members[m]], use_shortkey), seed) % SLOTS;
+          if (slots_[slot] >= 0)
+            break;
+          slots_[slot] = static_cast<int>(members[m]);
+        }
+        if (m == last) {
+          seeds_[b] = seed;
+          break;
+        }
+        for (size_t t = first; t < m; ++t)
+          slots_[spec_hash(key(specs[members[t]], use_shortkey), seed) % SLOTS] = -1;
+      }
+    }
+  }
+
+  //! \return index of the spec with this key, or -1
+  constexpr int find(const std::array<option_spec, N>& specs, std::string_view k, bool use_shortkey) const
+  {
+    if (k.empty())
+      return -1;
+    const int i = slots_[spec_hash(k, seeds_[spec_hash(k, 0) % BUCKETS]) % SLOTS];
+    return (i >= 0 && key(specs[i], use_shortkey) == k) ? i : -1;
+  }
+
+private:
+  static constexpr std::string_view key(const option_spec& spec, bool use_shortkey) { return use_shortkey ? spec.shortkey : spec.key; }
+
+private:
+  std::array<uint32_t, BUCKETS> seeds_;
+  std::array<int, SLOTS> slots_;
+};
+
+} // namespace detail
+
+//! constexpr table of option_specs with perfect hashing of long and short keys
+template <size_t N>
+class static_option_table
+{
+public:
+  constexpr static_option_table(const option_spec (&specs)[N])
+      : specs_(to_array(specs, std::make_index_sequence<N>()))
+      , keys_(specs_, false)
+      , shortkeys_(specs_, true)
+  {
+  }
+
+  static constexpr size_t size() { return N; }
+  constexpr const option_spec& operator[](size_t i) const { return specs_[i]; }
+
+  //! \return index of the option with this key, or -1
+  constexpr int find(std::string_view key, bool use_shortkey = false) const
+  {
+    return use_shortkey ? shortkeys_.find(specs_, key, true) : keys_.find(specs_, key, false);
+  }
+
+private:
+  template <size_t... I>
+  static constexpr std::array<option_spec, N> to_array(const option_spec (&specs)[N], std::index_sequence<I...>)
+  {
+    return {{specs[I]...}};
+  }
+
+private:
+  std::array<option_spec, N> specs_;
+  detail::spec_perfect_hash<N> keys_;
+  detail::spec_perfect_hash<N> shortkeys_;
+};
+
+/*!
+ * Options created from a static_option_table.
+ *
+ * The option objects are needed as keys for value_set. The option_set
+ * returned by options() contains all of them, and finds keys through
+ * the table's perfect hash.
+ */
+template <size_t N>
+class static_option_set : private option_index
+{
+public:
+  explicit static_option_set(const static_option_table<N>& table)
+      : table_(table)
+  {
+    options_.reserve(N);
+    for (size_t i = 0; i < N; ++i) {
+      const option_spec& spec = table_[i];
+      option o(std::string(spec.key), std::string(spec.help));
+      o.set_shortkey(std::string(spec.shortkey)).set_narg(spec.narg);
+      if (spec.has_default_value)
+        o.set_default_value(std::string(spec.default_value));
+      if (spec.has_implicit_value)
+        o.set_implicit_value(std::string(spec.implicit_value));
+      if (spec.is_composing)
+        o.set_composing();
+      if (spec.is_overwriting)
+        o.set_overwriting();
+      options_.push_back(std::move(o));
+    }
+    for (const option& o : options_)
+      set_.add(o);
+    set_.set_index(this);
+  }
+
+  static_option_set(const static_option_set&) = delete;
+  static_option_set& operator=(const static_option_set&) = delete;
+
+  const option& operator[](size_t i) const { return options_[i]; }
+  option_set& options() { return set_; }
+
+private:
+  option_cx find(const std::string& key, bool use_shortkey) const override
+  {
+    const int i = table_.find(key, use_shortkey);
+    return i >= 0 ? &options_[i] : nullptr;
+  }
+
+private:
+  const static_option_table<N>& table_;
+  std::vector<option> options_;
+  option_set set_;
+};
+
+} // namespace program_options
+} // namespace miutil
+
+#endif // MI_PROGRAMOPTIONS_STATIC_H
@@ -30,9 +30,9 @@
 #ifndef MI_PROGRAMOPTIONS_VERSION_H
 #define MI_PROGRAMOPTIONS_VERSION_H
 
-#define MI_PROGRAMOPTIONS_VERSION_MAJOR 2
+#define MI_PROGRAMOPTIONS_VERSION_MAJOR 3
 #define MI_PROGRAMOPTIONS_VERSION_MINOR 0
-#define MI_PROGRAMOPTIONS_VERSION_PATCH 1
+#define MI_PROGRAMOPTIONS_VERSION_PATCH 0
 
 #define MI_PROGRAMOPTIONS_VERSION_INT(major,minor,patch) \
     (1000000*major + 1000*minor + patch)
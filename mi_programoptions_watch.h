@@ -0,0 +1,97 @@
+/*
+  mi-programoptions
+
+  Copyright (C) 2026 met.no
+
+  Contact information:
+  Norwegian Meteorological Institute
+  Box 43 Blindern
+  0313 OSLO
+  NORWAY
+  email: diana@met.no
+
+  This file is part of mi-programoptions.
+
+  mi-programoptions is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  mi-programoptions is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with mi-programoptions; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef MI_PROGRAMOPTIONS_WATCH_H
+#define MI_PROGRAMOPTIONS_WATCH_H
+
+#include "mi_programoptions.h"
+
+#include <functional>
+#include <memory>
+
+namespace miutil {
+namespace program_options {
+
+/*!
+ * Re-parses a config file when it changes.
+ *
+ * The values are published as value_snapshots through an
+ * atomic_value_snapshot. values() may wait briefly while a new snapshot
+ * is stored, see there; readers keep the snapshot they got from values()
+ * for as long as they need it, and lookups in it never wait.
+ *
+ * The option_set must not be changed or used by other threads while
+ * watching.
+ */
+class config_watcher
+{
+public:
+  typedef value_snapshot snapshot_t;
+  typedef std::function<void(const snapshot_t& values, const std::vector<option_cx>& changed)> change_handler;
+  typedef std::function<void(const std::string& error)> error_handler;
+
+  //! parse filename for the first time, throws option_error if this fails
+  config_watcher(const std::string& filename, option_set& options, const config_settings& settings = config_settings());
+  ~config_watcher();
+
+  //! the current values
+  snapshot_t values() const;
+
+  //! called from the watching thread after the values changed; set before start()
+  config_watcher& on_change(const change_handler& handler);
+
+  //! called from the watching thread if the changed file cannot be parsed; set before start()
+  config_watcher& on_error(const error_handler& handler);
+
+  //! start watching in a background thread, using inotify on Linux
+  void start();
+  void stop();
+
+  /*!
+   * Parse the file now.
+   *
+   * If this fails, the error handler is called, and the values are
+   * not changed.
+   *
+   * \return true if the values changed
+   */
+  bool reload();
+
+private:
+  config_watcher(const config_watcher&);
+  config_watcher& operator=(const config_watcher&);
+
+  struct impl;
+  std::unique_ptr<impl> p_;
+};
+
+} // namespace program_options
+} // namespace miutil
+
+#endif // MI_PROGRAMOPTIONS_WATCH_H
@@ -2,6 +2,22 @@
 #include "mi_cpptest.h"
 
 #include "mi_programoptions.h"
+#include "mi_programoptions_watch.h"
+#include "mi_po_lexer.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+#if __cplusplus >= 201703L
+#include "mi_programoptions_pmr.h"
+#include "mi_programoptions_static.h"
+#endif
 
 using namespace miutil::program_options;
 
@@ -147,6 +163,50 @@ MI_CPPTEST_TEST_CASE(progopt_consume_positional)
   MI_CPPTEST_CHECK_EQ("hey", values.value(o2));
 }
 
+namespace {
+struct counting_sink : positional_sink
+{
+  size_t count = 0;
+  std::string last;
+  void put_positional(std::string&& arg) override
+  {
+    count += 1;
+    last = std::move(arg);
+  }
+};
+} // namespace
+
+MI_CPPTEST_TEST_CASE(progopt_consume_positional_move)
+{
+  const option o1 = option("one.setting", "this is a setting").set_composing();
+  const option o2 = option("one.pair", "two values").set_narg(2);
+
+  option_set options;
+  options.add(o1).add(o2);
+
+  counting_sink sink;
+  value_set values = parse_command_line({"a", "--one.setting", "hei", "b", "c"}, options, sink);
+  MI_CPPTEST_CHECK_EQ(3, sink.count);
+  MI_CPPTEST_CHECK_EQ("c", sink.last);
+  MI_CPPTEST_CHECK_EQ("hei", values.value(o1));
+
+  string_v positional{"x", "y", "z", "left"};
+  positional_args_consumer pac(values, std::move(positional));
+  pac >> o1 >> o2;
+  MI_CPPTEST_CHECK_EQ(2, values.values(o1).size());
+  MI_CPPTEST_CHECK_EQ("x", values.value(o1, 1));
+  MI_CPPTEST_CHECK_EQ("z", values.value(o2, 1));
+  MI_CPPTEST_CHECK_EQ(1, std::distance(pac.begin(), pac.end()));
+  MI_CPPTEST_CHECK_EQ("left", *pac.begin());
+
+  positional_args_consumer copy(pac);
+  MI_CPPTEST_CHECK_EQ("left", *copy.begin());
+  copy >> o1;
+  MI_CPPTEST_CHECK(copy.done());
+  MI_CPPTEST_CHECK(!pac.done());
+  MI_CPPTEST_CHECK_THROW(copy >> o1, option_error);
+}
+
 MI_CPPTEST_TEST_CASE(progopt_end_of_options)
 {
   const option o1 = std::move(option("one.setting", "this is a setting").set_composing());
@@ -214,3 +274,1162 @@ MI_CPPTEST_TEST_CASE(progopt_overwriting)
   const value_set values2 = parse_command_line(cmdline, options, positional);
   MI_CPPTEST_CHECK_EQ("he", values2.value(&os));
 }
+
+namespace {
+void check_scan_option(const std::string& arg)
+{
+  static const std::regex re_option("(-{1,2})([a-zA-Z0-9._][a-zA-Z0-9._-]*)(=(.*))?");
+  std::smatch match;
+  const bool re_ok = std::regex_match(arg, match, re_option);
+
+  miutil::program_options::detail::option_token token;
+  const bool scan_ok = miutil::program_options::detail::scan_option(arg.data(), arg.data() + arg.size(), token);
+
+  MI_CPPTEST_CHECK_EQ(re_ok, scan_ok);
+  if (re_ok && scan_ok) {
+    MI_CPPTEST_CHECK_EQ(match[1].length() == 1, token.shortkey);
+    MI_CPPTEST_CHECK_EQ(match[2].str(), std::string(token.key_begin, token.key_end));
+    MI_CPPTEST_CHECK_EQ(match[4].matched, token.has_value);
+    if (token.has_value)
+      MI_CPPTEST_CHECK_EQ(match[4].str(), std::string(token.value_begin, token.value_end));
+  }
+}
+} // namespace
+
+MI_CPPTEST_TEST_CASE(progopt_scan_option_like_regex)
+{
+  const std::string alphabet("-=aZ9._ \n\r\t#");
+  std::vector<size_t> idx;
+  for (size_t length = 0; length <= 5; ++length) {
+    idx.assign(length, 0);
+    std::string arg(length, ' ');
+    while (true) {
+      for (size_t i = 0; i < length; ++i)
+        arg[i] = alphabet[idx[i]];
+      check_scan_option(arg);
+
+      size_t i = 0;
+      for (; i < length; ++i) {
+        if (++idx[i] < alphabet.size())
+          break;
+        idx[i] = 0;
+      }
+      if (i == length)
+        break;
+    }
+  }
+  check_scan_option(std::string("--key=\0value", 12));
+  check_scan_option("--one.setting-x=a=b");
+}
+
+namespace {
+void check_scan_config_line(const std::string& text)
+{
+  static const std::regex re_comment("\\s*#.*");
+  static const std::regex re_section("\\[([a-zA-Z0-9._][a-zA-Z0-9._-]*)\\]$");
+  static const std::regex re_value("\\s*([a-zA-Z0-9._][a-zA-Z0-9._-]*)\\s*=\\s*(.*)?\\s*");
+
+  miutil::program_options::detail::config_line line;
+  const auto kind = miutil::program_options::detail::scan_config_line(text.data(), text.data() + text.size(), line);
+
+  std::smatch match;
+  if (text.empty()) {
+    MI_CPPTEST_CHECK_EQ(miutil::program_options::detail::LINE_EMPTY, kind);
+  } else if (std::regex_match(text, match, re_comment)) {
+    MI_CPPTEST_CHECK_EQ(miutil::program_options::detail::LINE_COMMENT, kind);
+  } else if (std::regex_match(text, match, re_section)) {
+    MI_CPPTEST_CHECK_EQ(miutil::program_options::detail::LINE_SECTION, kind);
+    if (kind == miutil::program_options::detail::LINE_SECTION)
+      MI_CPPTEST_CHECK_EQ(match[1].str(), std::string(line.key_begin, line.key_end));
+  } else if (std::regex_match(text, match, re_value)) {
+    MI_CPPTEST_CHECK_EQ(miutil::program_options::detail::LINE_VALUE, kind);
+    if (kind == miutil::program_options::detail::LINE_VALUE) {
+      std::string value = match[2].str();
+      if (value.size() >= 2 && (value[0] == '\'' || value[0] == '"') && value[0] == value[value.size() - 1])
+        value = value.substr(1, value.size() - 2);
+      MI_CPPTEST_CHECK_EQ(match[1].str(), std::string(line.key_begin, line.key_end));
+      MI_CPPTEST_CHECK_EQ(value, std::string(line.value_begin, line.value_end));
+    }
+  } else {
+    MI_CPPTEST_CHECK_EQ(miutil::program_options::detail::LINE_BAD, kind);
+  }
+}
+} // namespace
+
+MI_CPPTEST_TEST_CASE(progopt_scan_config_line_like_regex)
+{
+  const std::string alphabet("[]=#a.-' \r\t");
+  std::vector<size_t> idx;
+  for (size_t length = 0; length <= 5; ++length) {
+    idx.assign(length, 0);
+    std::string text(length, ' ');
+    while (true) {
+      for (size_t i = 0; i < length; ++i)
+        text[i] = alphabet[idx[i]];
+      check_scan_config_line(text);
+
+      size_t i = 0;
+      for (; i < length; ++i) {
+        if (++idx[i] < alphabet.size())
+          break;
+        idx[i] = 0;
+      }
+      if (i == length)
+        break;
+    }
+  }
+  check_scan_config_line("  one.setting  =  \"quoted value\" \r");
+  check_scan_config_line("[model.ensemble]");
+}
+
+MI_CPPTEST_TEST_CASE(progopt_config_file_long_lines)
+{
+  const option o1("one.setting", "this is a setting");
+  const option o2("two", "this is another setting");
+
+  option_set options;
+  options.add(o1).add(o2);
+
+  // longer than the line reader's initial buffer, and no newline at the end
+  const std::string long_value(200000, 'x');
+  std::istringstream configfile("# comment\n\n[one]\nsetting = '" + long_value + "'\n[]\n");
+  MI_CPPTEST_CHECK_THROW(parse_config_file(configfile, options), option_error);
+
+  std::istringstream configfile2("two=" + long_value + "\n[one]\nsetting=2");
+  const value_set values = parse_config_file(configfile2, options);
+  MI_CPPTEST_CHECK_EQ(long_value, values.value(o2));
+  MI_CPPTEST_CHECK_EQ("2", values.value(o1));
+
+  std::istringstream configfile3("[one]\nsetting=2\n  bad\n");
+  try {
+    parse_config_file(configfile3, options);
+    MI_CPPTEST_CHECK(false);
+  } catch (option_error& oe) {
+    MI_CPPTEST_CHECK_EQ(std::string("bad line 3:   bad"), oe.what());
+  }
+}
+
+MI_CPPTEST_TEST_CASE(progopt_find_option_index)
+{
+  option o1 = option("one.setting", "this is a setting").set_shortkey("os");
+  const option o2 = option("one.option", "this is an option").add_key("one.setting");
+
+  option_set options;
+  options.add(o1);
+  MI_CPPTEST_CHECK_EQ(&o1, options.find_option("one.setting"));
+  MI_CPPTEST_CHECK_EQ(&o1, options.find_option("os", true));
+
+  // added after the index was built
+  options.add(o2);
+  MI_CPPTEST_CHECK_EQ(&o1, options.find_option("one.setting"));
+  MI_CPPTEST_CHECK_EQ(&o2, options.find_option("one.option"));
+  MI_CPPTEST_CHECK_THROW(options.find_option("one.option", true), option_error);
+
+  // changed after the index was built
+  o1.add_key("one.other").set_shortkey("oo");
+  MI_CPPTEST_CHECK_EQ(&o1, options.find_option("one.other"));
+  MI_CPPTEST_CHECK_EQ(&o1, options.find_option("oo", true));
+  MI_CPPTEST_CHECK_THROW(options.find_option("os", true), option_error);
+
+  options.freeze();
+  MI_CPPTEST_CHECK_EQ(&o1, options.find_option("oo", true));
+  MI_CPPTEST_CHECK_THROW(options.find_option("no.such.option"), option_error);
+
+  // a key added to an earlier option is only preferred after freeze
+  o1.add_key("one.option");
+  options.freeze();
+  MI_CPPTEST_CHECK_EQ(&o1, options.find_option("one.option"));
+}
+
+#if __cplusplus >= 201703L
+namespace {
+constexpr option_spec static_specs[] = {
+    option_spec("help", "show help").set_shortkey("h").set_narg(0),
+    option_spec("model.steps", "number of steps").set_default_value("10"),
+    option_spec("input", "input files").set_shortkey("i").set_composing(),
+    option_spec("model.name", "model name"),
+};
+constexpr static_option_table static_table(static_specs);
+constexpr size_t STATIC_HELP = static_table.find("help");
+constexpr size_t STATIC_INPUT = static_table.find("i", true);
+static_assert(STATIC_HELP == 0 && STATIC_INPUT == 2, "static option table lookup");
+static_assert(static_table.find("no.such.option") == -1, "static option table miss");
+static_assert(static_table.find("h") == -1, "static option table short key as long key");
+} // namespace
+
+MI_CPPTEST_TEST_CASE(progopt_static_option_table)
+{
+  static_option_set options(static_table);
+  const option& steps = options[static_table.find("model.steps")];
+
+  std::vector<std::string> cmdline{"-h", "-i", "a", "--input=b", "file"};
+  string_v positional;
+  const value_set values = parse_command_line(cmdline, options.options(), positional);
+  MI_CPPTEST_CHECK(values.is_set(options[STATIC_HELP]));
+  MI_CPPTEST_CHECK_EQ(2, values.values(options[STATIC_INPUT]).size());
+  MI_CPPTEST_CHECK_EQ("10", values.value(steps));
+  MI_CPPTEST_CHECK_EQ(1, positional.size());
+
+  MI_CPPTEST_CHECK_EQ(&steps, options.options().find_option("model.steps"));
+  MI_CPPTEST_CHECK_THROW(options.options().find_option("steps"), option_error);
+
+  std::istringstream configfile("[model]\nname=x\n");
+  MI_CPPTEST_CHECK_EQ("x", parse_config_file(configfile, options.options()).value(options[3]));
+}
+
+MI_CPPTEST_TEST_CASE(progopt_static_option_table_large)
+{
+  static constexpr option_spec specs[] = {
+#define SPEC(n) option_spec("option." #n, "option " #n).set_shortkey("o" #n)
+#define SPEC10(n) SPEC(n##0), SPEC(n##1), SPEC(n##2), SPEC(n##3), SPEC(n##4), SPEC(n##5), SPEC(n##6), SPEC(n##7), SPEC(n##8), SPEC(n##9)
+#define SPEC100(n) SPEC10(n##0), SPEC10(n##1), SPEC10(n##2), SPEC10(n##3), SPEC10(n##4), SPEC10(n##5), SPEC10(n##6), SPEC10(n##7), SPEC10(n##8), SPEC10(n##9)
+#define SPEC1000(n) SPEC100(n##0), SPEC100(n##1), SPEC100(n##2), SPEC100(n##3), SPEC100(n##4), SPEC100(n##5), SPEC100(n##6), SPEC100(n##7), SPEC100(n##8), SPEC100(n##9)
+      SPEC1000(1), SPEC1000(2),
+#undef SPEC1000
+#undef SPEC100
+#undef SPEC10
+#undef SPEC
+  };
+  static constexpr static_option_table table(specs);
+  MI_CPPTEST_CHECK_EQ(2000, table.size());
+  for (size_t i = 0; i < table.size(); ++i) {
+    MI_CPPTEST_CHECK_EQ((int)i, table.find(table[i].key));
+    MI_CPPTEST_CHECK_EQ((int)i, table.find(table[i].shortkey, true));
+  }
+}
+#endif
+
+MI_CPPTEST_TEST_CASE(progopt_values_ordinal)
+{
+  const option o1("one.setting", "this is a setting");
+  const option o2("one.option", "this is an option");
+  const option o3("other", "this is in another set");
+  const option o4("unregistered", "this is in no set");
+
+  option_set options;
+  options.add(o1).add(o2);
+  option_set others;
+  others.add(o3).add(o1);
+  MI_CPPTEST_CHECK_EQ(0, o1.ordinal());
+  MI_CPPTEST_CHECK_EQ(1, o2.ordinal());
+  MI_CPPTEST_CHECK_EQ(0, o3.ordinal());
+  MI_CPPTEST_CHECK_EQ(option::NO_ORDINAL, o4.ordinal());
+  MI_CPPTEST_CHECK_EQ(option::NO_ORDINAL, option(o1).ordinal());
+
+  value_set values;
+  values.put(&o2, "2");
+  values.put(&o3, "3"); // same ordinal as o1
+  values.put(&o1, "1");
+  values.put(&o4, "4");
+  MI_CPPTEST_CHECK_EQ("1", values.value(o1));
+  MI_CPPTEST_CHECK_EQ("2", values.value(o2));
+  MI_CPPTEST_CHECK_EQ("3", values.value(o3));
+  MI_CPPTEST_CHECK_EQ("4", values.value(o4));
+  MI_CPPTEST_CHECK_EQ(&o4, values.find("unregistered"));
+  MI_CPPTEST_CHECK_EQ(&o3, values.find("other"));
+
+  value_set copy;
+  copy.add(values);
+  MI_CPPTEST_CHECK_EQ("1", copy.value(o1));
+  MI_CPPTEST_CHECK_EQ("4", copy.value(o4));
+  MI_CPPTEST_CHECK_THROW(copy.add(values), option_error);
+
+  // a slot freed by erase is taken over by an option with values in the map
+  const option a("a", "first in set 1");
+  const option b = option("b", "first in set 2").set_composing();
+  option_set set1, set2;
+  set1.add(a);
+  set2.add(b);
+  value_set shared;
+  shared.put(&a, "1");
+  shared.put(&b, "x");
+  shared.erase(&a);
+  shared.put(&b, "y");
+  MI_CPPTEST_CHECK(!shared.is_set(a));
+  MI_CPPTEST_CHECK_EQ(2, shared.values(b).size());
+  MI_CPPTEST_CHECK_EQ("y", shared.value(b, 1));
+}
+
+MI_CPPTEST_TEST_CASE(progopt_cmdline_views)
+{
+  const option o1 = option("one.setting", "this is a setting").set_composing();
+  const option o2 = option("this.option", "this expects two").set_shortkey("to").set_narg(2);
+
+  option_set options;
+  options.add(o1).add(o2);
+
+  const char* argv[] = {"test.exe", "--one.setting", "hei", "file1", "-to", "a", "b", "--", "--one.setting=hi"};
+  const int argc = sizeof(argv) / sizeof(argv[0]);
+
+  std::vector<const char*> positional;
+  const value_set values = parse_command_line(argc, argv, options, positional);
+  MI_CPPTEST_CHECK_EQ(1, values.values(o1).size());
+  MI_CPPTEST_CHECK_EQ("b", values.value(o2, 1));
+  MI_CPPTEST_CHECK_EQ(2, positional.size());
+  MI_CPPTEST_CHECK_EQ(argv[3], positional[0]);
+  MI_CPPTEST_CHECK_EQ(argv[8], positional[1]);
+
+#if __cplusplus >= 201703L
+  std::vector<std::string_view> positional_sv;
+  parse_command_line(argc, argv, options, positional_sv);
+  MI_CPPTEST_CHECK_EQ(2, positional_sv.size());
+  MI_CPPTEST_CHECK_EQ(argv[8], positional_sv[1].data());
+#endif
+}
+
+#if __cplusplus >= 201703L
+MI_CPPTEST_TEST_CASE(progopt_pmr_values)
+{
+  const option o1 = option("one.setting", "this is a setting").set_composing();
+  const option o2 = option("two", "this expects two").set_narg(2);
+  const option o3 = option("three", "this has a default").set_default_value("3");
+
+  option_set options;
+  options.add(o1).add(o2).add(o3);
+
+  char buffer[4096];
+  std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+
+  const std::string long_value(100, 'x');
+  std::istringstream configfile("[one]\nsetting=" + long_value + "\n");
+  pmr::value_set values = pmr::parse_config_file(configfile, options, &arena);
+  MI_CPPTEST_CHECK_EQ(long_value, values.value(o1));
+  MI_CPPTEST_CHECK(values.values(o1).get_allocator().resource() == &arena);
+
+  const char* argv[] = {"test.exe", "--two", "a long value that does not fit into a small string", "b", "file"};
+  const int argc = sizeof(argv) / sizeof(argv[0]);
+  pmr::value_set cmdline = pmr::parse_command_line(argc, argv, options, &arena);
+  MI_CPPTEST_CHECK_EQ("b", cmdline.value(o2, 1));
+  MI_CPPTEST_CHECK_EQ("3", cmdline.value(o3));
+  MI_CPPTEST_CHECK_EQ(1, cmdline.positional().size());
+  MI_CPPTEST_CHECK_EQ(argv[4], cmdline.positional()[0].data());
+
+  values.add(cmdline);
+  MI_CPPTEST_CHECK_EQ(1, values.values(o1).size());
+  MI_CPPTEST_CHECK(values.is_set(o2));
+  MI_CPPTEST_CHECK_EQ(&o2, values.find("two"));
+
+  MI_CPPTEST_CHECK_THROW(values.put(&o2, "c"), option_error);
+  MI_CPPTEST_CHECK_THROW(values.add(cmdline), option_error);
+
+  // positional views could not point into a response file after parsing
+  options.set_response_files(true);
+  const char* rsp_argv[] = {"test.exe", "@test_programoptions_pmr.rsp"};
+  MI_CPPTEST_CHECK_THROW(pmr::parse_command_line(2, rsp_argv, options, &arena), option_error);
+}
+#endif
+
+MI_CPPTEST_TEST_CASE(progopt_values_as)
+{
+  const option o1 = option("steps", "number of steps").set_default_value("10");
+  const option o2 = option("levels", "list of levels").set_composing();
+  const option o3 = option("scale", "scale factor");
+  const option o4 = option("verbose", "be verbose");
+
+  option_set options;
+  options.add(o1).add(o2).add(o3).add(o4);
+
+  std::istringstream configfile("levels=1000\nlevels=-850\nscale = 2.5e-1 \nverbose=yes\n");
+  value_set values = parse_config_file(configfile, options);
+
+  MI_CPPTEST_CHECK_EQ(10, values.value_as<int>(o1));
+  MI_CPPTEST_CHECK_EQ(0.25, values.value_as<double>(o3));
+  MI_CPPTEST_CHECK_EQ(true, values.value_as<bool>(o4));
+  MI_CPPTEST_CHECK_THROW(values.value_as<int>(o4), option_error);
+  MI_CPPTEST_CHECK_THROW(values.value_as<unsigned int>(o2, 1), option_error);
+
+  const std::vector<int>& levels = values.values_as<int>(o2);
+  MI_CPPTEST_CHECK_EQ(2, levels.size());
+  MI_CPPTEST_CHECK_EQ(-850, levels[1]);
+  MI_CPPTEST_CHECK_EQ(&levels, &values.values_as<int>(o2));
+  MI_CPPTEST_CHECK_EQ(1000.0, values.values_as<double>(o2)[0]);
+
+  values.put(&o2, "500");
+  MI_CPPTEST_CHECK_EQ(3, values.values_as<int>(o2).size());
+
+  try {
+    values.value_as<int>(o4);
+  } catch (option_error& oe) {
+    MI_CPPTEST_CHECK_EQ(std::string("option 'verbose' has invalid value 'yes'"), oe.what());
+  }
+}
+
+MI_CPPTEST_TEST_CASE(progopt_convert_value)
+{
+  int i = 0;
+  const std::string int_min = std::to_string(std::numeric_limits<int>::min());
+  MI_CPPTEST_CHECK(convert_value(int_min.data(), int_min.data() + int_min.size(), i));
+  MI_CPPTEST_CHECK_EQ(std::numeric_limits<int>::min(), i);
+  const std::string int_over = "2147483648";
+  MI_CPPTEST_CHECK(!convert_value(int_over.data(), int_over.data() + int_over.size(), i));
+
+  unsigned long long ull = 0;
+  const std::string ull_max = "18446744073709551615";
+  MI_CPPTEST_CHECK(convert_value(ull_max.data(), ull_max.data() + ull_max.size(), ull));
+  MI_CPPTEST_CHECK_EQ(std::numeric_limits<unsigned long long>::max(), ull);
+
+  const std::string bad[] = {"", "-", "1x", "+1", "1 2", "0x10"};
+  for (const std::string& b : bad)
+    MI_CPPTEST_CHECK(!convert_value(b.data(), b.data() + b.size(), i));
+
+  double d = 0;
+  const std::string d_text = " -1.5e3";
+  MI_CPPTEST_CHECK(convert_value(d_text.data(), d_text.data() + d_text.size(), d));
+  MI_CPPTEST_CHECK_EQ(-1500.0, d);
+  const std::string d_bad[] = {"1,5", "1e999", "inf", "-infinity", "nan", "0x1p3"};
+  for (const std::string& b : d_bad)
+    MI_CPPTEST_CHECK(!convert_value(b.data(), b.data() + b.size(), d));
+
+  float f = 0;
+  const std::string f_text = "1e30", f_bad = "1e40";
+  MI_CPPTEST_CHECK(convert_value(f_text.data(), f_text.data() + f_text.size(), f));
+  MI_CPPTEST_CHECK(!convert_value(f_bad.data(), f_bad.data() + f_bad.size(), f));
+}
+
+MI_CPPTEST_TEST_CASE(progopt_config_file_threads)
+{
+  const option o1 = option("one.setting", "this is a setting").set_composing();
+  const option o2 = option("one.option", "this is an option").set_overwriting();
+  const option o3("no_dot", "this is special");
+
+  option_set options;
+  options.add(o1).add(o2).add(o3);
+
+  // several MB, so that there are multiple chunks
+  std::ostringstream config;
+  config << "no_dot=5\n";
+  for (int i = 0; i < 200000; ++i) {
+    if (i % 1000 == 0)
+      config << "[one]\n# comment\n\n";
+    config << "setting = " << i << "\noption='" << i << "'\n";
+  }
+  const std::string text = config.str();
+
+  std::istringstream configfile1(text);
+  const value_set values1 = parse_config_file(configfile1, options);
+  std::istringstream configfile4(text);
+  const value_set values4 = parse_config_file(configfile4, options, config_settings().set_threads(4));
+
+  std::ostringstream dump1, dump4;
+  options.dump(dump1, values1);
+  options.dump(dump4, values4);
+  MI_CPPTEST_CHECK_EQ(200000, values4.values(o1).size());
+  MI_CPPTEST_CHECK_EQ("199999", values4.value(o2));
+  MI_CPPTEST_CHECK(dump1.str() == dump4.str());
+
+  // errors are reported as without threads
+  for (const std::string& bad : {std::string("[one]\nno_dot=1\n"), std::string("bad line\n")}) {
+    std::string error1, error4;
+    std::istringstream bad1(text + bad + text);
+    try {
+      parse_config_file(bad1, options);
+    } catch (option_error& oe) {
+      error1 = oe.what();
+    }
+    std::istringstream bad4(text + bad + text);
+    try {
+      parse_config_file(bad4, options, config_settings().set_threads(4));
+    } catch (option_error& oe) {
+      error4 = oe.what();
+    }
+    MI_CPPTEST_CHECK(!error1.empty());
+    MI_CPPTEST_CHECK_EQ(error1, error4);
+  }
+}
+
+MI_CPPTEST_TEST_CASE(progopt_config_file_by_name)
+{
+  const option o1("one.setting", "this is a setting");
+  const option o2("no_dot", "this is special");
+
+  option_set options;
+  options.add(o1).add(o2);
+
+  const std::string filename = "test_programoptions_config.tmp";
+  {
+    std::ofstream configfile(filename);
+    configfile << "no_dot=5\n[one]\nsetting=hei";
+  }
+  const value_set values = parse_config_file(filename, options);
+  MI_CPPTEST_CHECK_EQ("hei", values.value(o1));
+  MI_CPPTEST_CHECK_EQ("5", values.value(o2));
+
+  const value_set mapped = parse_config_file(filename, options, config_settings().set_memory_map(true));
+  MI_CPPTEST_CHECK_EQ("hei", mapped.value(o1));
+  MI_CPPTEST_CHECK_EQ("5", mapped.value(o2));
+
+  {
+    std::ofstream configfile(filename);
+  }
+  MI_CPPTEST_CHECK(!parse_config_file(filename, options, config_settings().set_memory_map(true)).is_set(o1));
+
+  {
+    std::ofstream configfile(filename);
+    configfile << "[one]\nbad\n";
+  }
+  try {
+    parse_config_file(filename, options);
+    MI_CPPTEST_CHECK(false);
+  } catch (option_error& oe) {
+    MI_CPPTEST_CHECK_EQ("while reading '" + filename + ": bad line 2: bad", oe.what());
+  }
+  std::remove(filename.c_str());
+
+  MI_CPPTEST_CHECK_THROW(parse_config_file(filename, options), option_error);
+
+#ifdef __unix__
+  // not a regular file, read as a stream
+  MI_CPPTEST_CHECK(!parse_config_file("/dev/null", options).is_set(o1));
+#endif
+}
+
+MI_CPPTEST_TEST_CASE(progopt_config_file_cache)
+{
+  const option o1 = option("one.setting", "this is a setting").set_composing();
+  const option o2("no_dot", "this is special");
+
+  option_set options;
+  options.add(o1).add(o2);
+
+  const std::string filename = "test_programoptions_cached.tmp";
+  const std::string cache_file = filename + ".cache";
+  {
+    std::ofstream configfile(filename);
+    configfile << "no_dot=5\n[one]\nsetting=hei\nsetting=hi\n";
+  }
+
+  const config_settings settings = config_settings().set_cache_file(cache_file);
+  const value_set values = parse_config_file(filename, options, settings);
+  MI_CPPTEST_CHECK_EQ(2, values.values(o1).size());
+
+  value_set cached;
+  MI_CPPTEST_CHECK(load_value_cache(cache_file, options, filename, cached));
+  MI_CPPTEST_CHECK_EQ("hi", cached.value(o1, 1));
+  MI_CPPTEST_CHECK_EQ("5", cached.value(o2));
+  MI_CPPTEST_CHECK_EQ("hi", parse_config_file(filename, options, settings).value(o1, 1));
+
+  // other options
+  const option o3("three", "this is new");
+  option_set other_options;
+  other_options.add(o1).add(o2).add(o3);
+  value_set other;
+  MI_CPPTEST_CHECK(!load_value_cache(cache_file, other_options, filename, other));
+
+  // changed source
+  {
+    std::ofstream configfile(filename);
+    configfile << "no_dot=6\n";
+  }
+  value_set changed;
+  MI_CPPTEST_CHECK(!load_value_cache(cache_file, options, filename, changed));
+  const value_set reparsed = parse_config_file(filename, options, settings);
+  MI_CPPTEST_CHECK_EQ("6", reparsed.value(o2));
+  MI_CPPTEST_CHECK(!reparsed.is_set(o1));
+  MI_CPPTEST_CHECK(load_value_cache(cache_file, options, filename, changed));
+
+  // corrupt value count of the first entry, after the 48 byte header and the key
+  {
+    std::fstream corrupt(cache_file, std::ios::in | std::ios::out | std::ios::binary);
+    corrupt.seekp(48 + 4 + o2.key().size());
+    const uint32_t count = 0xffffffff;
+    corrupt.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  }
+  value_set corrupted;
+  MI_CPPTEST_CHECK(!load_value_cache(cache_file, options, filename, corrupted));
+
+  // well-formed cache with the same key twice, the source is parsed instead
+  const option aa("aa", "first"), bb("bb", "second");
+  option_set two;
+  two << aa << bb;
+  {
+    std::ofstream configfile(filename);
+    configfile << "aa=1\nbb=2\n";
+  }
+  parse_config_file(filename, two, settings);
+  {
+    std::ifstream in(cache_file, std::ios::binary);
+    std::string cache((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    cache.replace(cache.find("bb", 48), 2, "aa");
+    std::ofstream out(cache_file, std::ios::binary);
+    out << cache;
+  }
+  value_set duplicate;
+  MI_CPPTEST_CHECK(!load_value_cache(cache_file, two, filename, duplicate));
+  const value_set reparsed_two = parse_config_file(filename, two, settings);
+  MI_CPPTEST_CHECK_EQ("2", reparsed_two.value(bb));
+
+  std::remove(filename.c_str());
+  std::remove(cache_file.c_str());
+}
+
+MI_CPPTEST_TEST_CASE(progopt_config_watcher)
+{
+  const option o1("one.setting", "this is a setting");
+  const option o2("no_dot", "this is special");
+
+  option_set options;
+  options.add(o1).add(o2);
+
+  const std::string filename = "test_programoptions_watched.tmp";
+  {
+    std::ofstream configfile(filename);
+    configfile << "no_dot=5\n[one]\nsetting=hei\n";
+  }
+
+  config_watcher watcher(filename, options);
+  const config_watcher::snapshot_t first = watcher.values();
+  MI_CPPTEST_CHECK_EQ("5", first->value(o2));
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<option_cx> changed;
+  std::string error;
+  watcher
+      .on_change([&](const config_watcher::snapshot_t&, const std::vector<option_cx>& c) {
+        std::lock_guard<std::mutex> lock(mutex);
+        changed = c;
+        cv.notify_all();
+      })
+      .on_error([&](const std::string& e) {
+        std::lock_guard<std::mutex> lock(mutex);
+        error = e;
+        cv.notify_all();
+      });
+
+  // unchanged values do not replace the snapshot
+  MI_CPPTEST_CHECK(!watcher.reload());
+  MI_CPPTEST_CHECK(first == watcher.values());
+
+  watcher.start();
+  {
+    std::ofstream configfile(filename);
+    configfile << "no_dot=6\n[one]\nsetting=hei\n";
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait_for(lock, std::chrono::seconds(5), [&] { return !changed.empty(); });
+    MI_CPPTEST_CHECK_EQ(1, changed.size());
+    MI_CPPTEST_CHECK(!changed.empty() && changed.front() == &o2);
+  }
+  MI_CPPTEST_CHECK_EQ("6", watcher.values()->value(o2));
+  MI_CPPTEST_CHECK_EQ("5", first->value(o2));
+
+  {
+    std::ofstream configfile(filename);
+    configfile << "[one]\nbad\n";
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait_for(lock, std::chrono::seconds(5), [&] { return !error.empty(); });
+    MI_CPPTEST_CHECK(!error.empty());
+  }
+  watcher.stop();
+  MI_CPPTEST_CHECK_EQ("6", watcher.values()->value(o2));
+
+  std::remove(filename.c_str());
+}
+
+MI_CPPTEST_TEST_CASE(progopt_value_snapshot_builder)
+{
+  const option o1 = option("one", "first").set_overwriting();
+  const option o2("two", "second");
+
+  value_set values;
+  values.put(&o1, "1");
+  const value_snapshot base(values);
+
+  value_snapshot_builder builder(base);
+  MI_CPPTEST_CHECK(base == builder.build());
+
+  const value_snapshot changed = builder.put(&o1, "11").put(&o2, "2").build();
+  MI_CPPTEST_CHECK(base != changed);
+  MI_CPPTEST_CHECK_EQ("1", base->value(o1));
+  MI_CPPTEST_CHECK(!base->is_set(o2));
+  MI_CPPTEST_CHECK_EQ(11, changed->value_as<int>(o1));
+  MI_CPPTEST_CHECK_EQ("2", changed->value(o2));
+
+  MI_CPPTEST_CHECK_THROW(builder.put(&o2, "22"), option_error);
+  MI_CPPTEST_CHECK_EQ("2", builder.build()->value(o2));
+}
+
+MI_CPPTEST_TEST_CASE(progopt_value_snapshot_threads)
+{
+  const option o1 = option("one", "first").set_overwriting();
+  const option o2 = option("two", "second").set_overwriting();
+  option_set options;
+  options << o1 << o2;
+
+  value_set initial;
+  initial.put(&o1, "0");
+  initial.put(&o2, "0");
+  atomic_value_snapshot current((value_snapshot(initial)));
+
+  std::atomic<bool> done(false);
+  std::atomic<int> mismatches(0);
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t) {
+    readers.push_back(std::thread([&]() {
+      int last = 0;
+      while (!done.load()) {
+        const value_snapshot snapshot = current.load();
+        const int one = snapshot->values_as<int>(&o1).front();
+        const int two = snapshot->value_as<long>(&o2);
+        if (one != two || one < last || snapshot->values_as<double>(&o1).front() != one)
+          mismatches += 1;
+        last = one;
+      }
+    }));
+  }
+
+  for (int i = 1; i <= 2000; ++i) {
+    const std::string text = std::to_string(i);
+    current.store(value_snapshot_builder(current.load()).put(&o1, text).put(&o2, text).build());
+  }
+  done = true;
+  for (std::thread& r : readers)
+    r.join();
+
+  MI_CPPTEST_CHECK_EQ(0, mismatches.load());
+  MI_CPPTEST_CHECK_EQ(2000, current.load()->value_as<int>(&o2));
+}
+
+MI_CPPTEST_TEST_CASE(progopt_config_file_incremental)
+{
+  const option o1("no_dot", "this is special");
+  const option o2("one.setting", "this is a setting");
+  const option o3 = option("one.list", "this is a list").set_composing();
+  const option o4("two.setting", "this is another setting");
+  const option o5 = option("three.list", "this is split").set_composing();
+
+  option_set options;
+  options << o1 << o2 << o3 << o4 << o5;
+
+  incremental_config_parser parser(options);
+  std::istringstream config1("no_dot=5\n[one]\nsetting=hei\nlist=a\nlist=b\n[two]\nsetting=hi\n[three]\nlist=x\n[three]\nlist=y\n");
+  MI_CPPTEST_CHECK_EQ(5, parser.parse(config1).size());
+  MI_CPPTEST_CHECK(parser.was_full_parse());
+  MI_CPPTEST_CHECK_EQ(2, parser.values().values(o3).size());
+
+  // one section changed
+  std::istringstream config2("no_dot=5\n[one]\nsetting=hei\nlist=a\nlist=c\n[two]\nsetting=hi\n[three]\nlist=x\n[three]\nlist=y\n");
+  std::vector<option_cx> changed = parser.parse(config2);
+  MI_CPPTEST_CHECK(!parser.was_full_parse());
+  MI_CPPTEST_CHECK_EQ(1, changed.size());
+  MI_CPPTEST_CHECK(!changed.empty() && changed.front() == &o3);
+  MI_CPPTEST_CHECK_EQ("c", parser.values().value(o3, 1));
+  MI_CPPTEST_CHECK_EQ("hi", parser.values().value(o4));
+
+  // section changed, but with the same values; option removed
+  std::istringstream config3("no_dot=5\n[one]\nsetting = hei\n[two]\nsetting=hi\n[three]\nlist=x\n[three]\nlist=y\n");
+  changed = parser.parse(config3);
+  MI_CPPTEST_CHECK(!parser.was_full_parse());
+  MI_CPPTEST_CHECK_EQ(1, changed.size());
+  MI_CPPTEST_CHECK(!parser.values().is_set(o3));
+
+  // option set in two sections
+  std::istringstream config4("no_dot=5\n[one]\nsetting = hei\n[two]\nsetting=hi\n[three]\nlist=x\n[three]\nlist=z\n");
+  changed = parser.parse(config4);
+  MI_CPPTEST_CHECK(parser.was_full_parse());
+  MI_CPPTEST_CHECK_EQ(1, changed.size());
+  MI_CPPTEST_CHECK_EQ("z", parser.values().value(o5, 1));
+
+  // sections removed
+  std::istringstream config5("no_dot=6\n[two]\nsetting=hi\n");
+  changed = parser.parse(config5);
+  MI_CPPTEST_CHECK(parser.was_full_parse());
+  MI_CPPTEST_CHECK_EQ(3, changed.size());
+
+  // errors keep the values, with the same line number as a full parse
+  std::istringstream config6("no_dot=6\n[two]\nsetting=hi\nbad\n");
+  try {
+    parser.parse(config6);
+    MI_CPPTEST_CHECK(false);
+  } catch (option_error& oe) {
+    MI_CPPTEST_CHECK_EQ("bad line 4: bad", std::string(oe.what()));
+  }
+  MI_CPPTEST_CHECK_EQ("6", parser.values().value(o1));
+
+  std::istringstream config7("no_dot=6\n[two]\nsetting=hi\n");
+  MI_CPPTEST_CHECK(parser.parse(config7).empty());
+}
+
+namespace {
+struct recording_visitor : option_visitor
+{
+  std::vector<std::string> events;
+
+  void visit(option_cx opt, const value_range* values, size_t count, const source_location& where) override
+  {
+    std::ostringstream e;
+    e << opt->key() << '@' << where.position << (where.filename ? where.filename : "") << ':';
+    for (size_t i = 0; i < count; ++i)
+      e << ' ' << std::string(values[i].begin, values[i].end);
+    events.push_back(e.str());
+  }
+
+  void visit_positional(const value_range& arg, const source_location& where) override
+  {
+    std::ostringstream e;
+    e << '@' << where.position << ": " << std::string(arg.begin, arg.end);
+    events.push_back(e.str());
+  }
+};
+} // namespace
+
+MI_CPPTEST_TEST_CASE(progopt_visitor)
+{
+  const option o1 = option("one.setting", "this is a setting").set_composing();
+  const option o2 = option("verbose", "talk more").set_shortkey("v").set_implicit_value("1");
+  const option o3 = option("pair", "two values").set_narg(2);
+
+  option_set options;
+  options << o1 << o2 << o3;
+
+  recording_visitor config;
+  std::istringstream configfile("# comment\n[one]\nsetting=hei\n\nsetting=hi\n");
+  parse_config_file(configfile, options, config);
+  MI_CPPTEST_CHECK_EQ(2, config.events.size());
+  MI_CPPTEST_CHECK_EQ("one.setting@3: hei", config.events.at(0));
+  MI_CPPTEST_CHECK_EQ("one.setting@5: hi", config.events.at(1));
+
+  recording_visitor cmdl;
+  const char* const argv[] = {"test.exe", "-v", "input", "--pair", "a", "b", "--one.setting=x"};
+  parse_command_line(7, argv, options, cmdl);
+  MI_CPPTEST_CHECK_EQ(4, cmdl.events.size());
+  MI_CPPTEST_CHECK_EQ("verbose@1: 1", cmdl.events.at(0));
+  MI_CPPTEST_CHECK_EQ("@2: input", cmdl.events.at(1));
+  MI_CPPTEST_CHECK_EQ("pair@3: a b", cmdl.events.at(2));
+  MI_CPPTEST_CHECK_EQ("one.setting@6: x", cmdl.events.at(3));
+
+  const std::string filename = "test_programoptions_visited.tmp";
+  {
+    std::ofstream out(filename);
+    out << "[one]\nsetting=file\n";
+  }
+  recording_visitor file;
+  parse_config_file(filename, options, file);
+  MI_CPPTEST_CHECK_EQ(1, file.events.size());
+  MI_CPPTEST_CHECK_EQ("one.setting@2" + filename + ": file", file.events.at(0));
+  std::remove(filename.c_str());
+}
+
+MI_CPPTEST_TEST_CASE(progopt_value_section)
+{
+  const option o1("model.steps", "number of steps");
+  const option o2 = option("model.ensemble.members", "members").set_composing();
+  const option o3 = option("model.ensemble.size", "ensemble size").set_default_value("10");
+  const option o4("modelling", "not in the section");
+  const option o5("output.dir", "output directory");
+
+  option_set options;
+  options << o5 << o4 << o3 << o2 << o1;
+
+  std::istringstream configfile("modelling=yes\n[model]\nsteps=5\n[model.ensemble]\nmembers=1\nmembers=2\n");
+  const value_set values = parse_config_file(configfile, options);
+
+  const value_section model(values, options, "model");
+  MI_CPPTEST_CHECK_EQ("model.", model.prefix());
+  MI_CPPTEST_CHECK(model.find("steps") == &o1);
+  MI_CPPTEST_CHECK(model.find("ling") == nullptr);
+  MI_CPPTEST_CHECK_EQ("5", model.value("steps"));
+  MI_CPPTEST_CHECK_EQ("10", model.value("ensemble.size"));
+  MI_CPPTEST_CHECK(!model.is_set("ensemble.size"));
+  MI_CPPTEST_CHECK_THROW(model.value("nothing"), option_error);
+
+  std::vector<std::string> keys;
+  for (const value_section::entry& e : model)
+    keys.push_back(e.key);
+  MI_CPPTEST_CHECK_EQ(2, keys.size());
+  MI_CPPTEST_CHECK_EQ("ensemble.members", keys.at(0));
+  MI_CPPTEST_CHECK_EQ("steps", keys.at(1));
+
+  const value_section ensemble = model.section("ensemble");
+  MI_CPPTEST_CHECK_EQ("model.ensemble.", ensemble.prefix());
+  const value_section::const_iterator it = ensemble.begin();
+  MI_CPPTEST_CHECK(it != ensemble.end() && it->opt == &o2 && it->values == values.get(o2));
+  MI_CPPTEST_CHECK_EQ(2, ensemble.get("members")->size());
+
+  const value_section empty(values, options, "nothing");
+  MI_CPPTEST_CHECK(empty.begin() == empty.end());
+
+  // lookups do not invalidate sections
+  const option_set::keyed_iterator first = options.find_prefix("model.").first;
+  options.find_option("output.dir");
+  options.freeze();
+  MI_CPPTEST_CHECK(options.find_prefix("model.").first == first);
+  MI_CPPTEST_CHECK_EQ(2, std::distance(model.begin(), model.end()));
+}
+
+MI_CPPTEST_TEST_CASE(progopt_environment)
+{
+  const option o1("model.steps", "number of steps");
+  const option o2 = option("input-files", "inputs").set_composing();
+  const option o3 = option("verbose", "talk more").set_implicit_value("1");
+  const option o4 = option("area", "corners").set_narg(2);
+  const option o5 = option("unused", "not in environment");
+  const option o6 = option("debug", "a flag").set_narg(0);
+
+  option_set options;
+  options << o1 << o2 << o3 << o4 << o5 << o6;
+
+  const char* const env[] = {"PATH=/usr/bin", "APP_MODEL_STEPS=12", "APP_INPUT_FILES=a.nc", "APP_VERBOSE=", "APP_AREA= 1  2", "APP_OTHER=x", "APP_MODEL_STEPSX=1", "APP_DEBUG=", nullptr};
+  const value_set values = parse_environment(options, "APP_", env);
+  MI_CPPTEST_CHECK_EQ("12", values.value(o1));
+  MI_CPPTEST_CHECK_EQ("a.nc", values.value(o2));
+  MI_CPPTEST_CHECK_EQ("1", values.value(o3));
+  MI_CPPTEST_CHECK_EQ(2, values.values(o4).size());
+  MI_CPPTEST_CHECK_EQ("2", values.value(o4, 1));
+  MI_CPPTEST_CHECK(!values.is_set(o5));
+  MI_CPPTEST_CHECK(values.is_set(o6));
+
+  const char* const bad[] = {"APP_AREA=1", nullptr};
+  try {
+    parse_environment(options, "APP_", bad);
+    MI_CPPTEST_CHECK(false);
+  } catch (option_error& oe) {
+    MI_CPPTEST_CHECK_EQ("environment variable 'APP_AREA': option 'area' expects 2 values", std::string(oe.what()));
+  }
+
+  const char* const flag[] = {"APP_DEBUG=0", nullptr};
+  try {
+    parse_environment(options, "APP_", flag);
+    MI_CPPTEST_CHECK(false);
+  } catch (option_error& oe) {
+    MI_CPPTEST_CHECK_EQ("environment variable 'APP_DEBUG': arg for no-arg option 'debug'", std::string(oe.what()));
+  }
+
+  const char* const lower[] = {"app.model.steps=3", nullptr};
+  struct same
+  {
+    static std::string name(const std::string& key) { return key; }
+  };
+  MI_CPPTEST_CHECK_EQ("3", parse_environment(options, "app.", lower, &same::name).value(o1));
+}
+
+MI_CPPTEST_TEST_CASE(progopt_layered_values)
+{
+  const option o1("model.steps", "number of steps");
+  const option o2 = option("input", "inputs").set_composing();
+  const option o3 = option("output", "output file").set_default_value("out.nc");
+
+  value_set defaults, config, command_line;
+  defaults.put(&o1, "10");
+  defaults.put(&o2, "a.nc");
+  config.put(&o2, "b.nc");
+  config.put(&o2, "c.nc");
+  command_line.put(&o1, "12");
+
+  layered_values values;
+  values << defaults << config << command_line;
+  MI_CPPTEST_CHECK_EQ(3, values.layers());
+
+  MI_CPPTEST_CHECK(values.top_layer(&o1) == &command_line);
+  MI_CPPTEST_CHECK_EQ("12", values.value(o1));
+  MI_CPPTEST_CHECK_EQ(1, values.count(o1));
+
+  MI_CPPTEST_CHECK_EQ(3, values.count(o2));
+  MI_CPPTEST_CHECK_EQ("a.nc", values.value(o2, 0));
+  MI_CPPTEST_CHECK_EQ("c.nc", values.value(o2, 2));
+  MI_CPPTEST_CHECK_THROW(values.value(o2, 3), std::out_of_range);
+  std::string all;
+  values.for_each(&o2, [&](const std::string& v) { all += v; });
+  MI_CPPTEST_CHECK_EQ("a.ncb.ncc.nc", all);
+
+  MI_CPPTEST_CHECK(!values.is_set(o3));
+  MI_CPPTEST_CHECK_EQ(0, values.count(o3));
+  MI_CPPTEST_CHECK_EQ("out.nc", values.value(o3));
+}
+
+MI_CPPTEST_TEST_CASE(progopt_value_set_move)
+{
+  const option o1("one", "first");
+  const option o2 = option("two", "second").set_composing();
+  const option o3 = option("three", "third").set_narg(2).set_overwriting();
+
+  value_set values;
+  std::string text(100, 'x');
+  const char* data = text.data();
+  values.put(&o1, std::move(text));
+  MI_CPPTEST_CHECK(values.value(o1).data() == data);
+
+  const char literal[] = "abc";
+  values.emplace(&o2, literal, literal + 2);
+  values.emplace(&o2, literal + 1, literal + 3);
+  MI_CPPTEST_CHECK_EQ("ab", values.value(o2, 0));
+  MI_CPPTEST_CHECK_EQ("bc", values.value(o2, 1));
+  MI_CPPTEST_CHECK_THROW(values.emplace(&o1, literal, literal + 1), option_error);
+
+  string_v pair{"a", "b"};
+  values.put(&o3, std::move(pair));
+  values.put(&o3, string_v{"c", "d"});
+  MI_CPPTEST_CHECK_EQ(2, values.values(o3).size());
+  MI_CPPTEST_CHECK_EQ("d", values.value(o3, 1));
+
+  // moving into an empty value_set takes over the storage
+  value_set target;
+  const std::string* one = &values.value(o1);
+  target.add(std::move(values));
+  MI_CPPTEST_CHECK(&target.value(o1) == one);
+  MI_CPPTEST_CHECK(!values.is_set(o1));
+
+  value_set more;
+  more.put(&o1, "again");
+  MI_CPPTEST_CHECK_THROW(target.add(std::move(more)), option_error);
+  MI_CPPTEST_CHECK(more.is_set(o1));
+  MI_CPPTEST_CHECK_EQ(2, target.values(o2).size());
+}
+
+MI_CPPTEST_TEST_CASE(progopt_option_copy_shares_text)
+{
+  const option o1 = option("model.steps", "number of steps").set_shortkey("s").set_default_value("10").set_composing();
+  option o2 = o1;
+  MI_CPPTEST_CHECK(&o1.key() == &o2.key());
+  MI_CPPTEST_CHECK(o2.is_composing() && !o2.is_overwriting());
+  MI_CPPTEST_CHECK_EQ(option::NO_ORDINAL, o2.ordinal());
+
+  // changing the copy does not change the original
+  o2.add_key("steps").set_default_value("12").set_overwriting();
+  MI_CPPTEST_CHECK(&o1.key() != &o2.key());
+  MI_CPPTEST_CHECK_EQ(1, o1.keys().size());
+  MI_CPPTEST_CHECK_EQ(2, o2.keys().size());
+  MI_CPPTEST_CHECK_EQ("10", o1.default_value());
+  MI_CPPTEST_CHECK_EQ("12", o2.default_value());
+  MI_CPPTEST_CHECK(o1.is_composing() && !o1.is_overwriting());
+  MI_CPPTEST_CHECK(!o2.is_composing() && o2.is_overwriting());
+  MI_CPPTEST_CHECK(o2.match("s", true));
+}
+
+MI_CPPTEST_TEST_CASE(progopt_parse_stats)
+{
+  const option o1 = option("one.setting", "this is a setting").set_composing();
+  const option o2 = option("pair", "two values").set_narg(2);
+
+  parse_stats stats;
+  option_set options;
+  options << o1 << o2;
+  options.set_stats(&stats);
+
+  std::istringstream configfile("# comment\n[one]\nsetting=hei\nsetting=hi\n");
+  parse_config_file(configfile, options);
+  MI_CPPTEST_CHECK_EQ(4, stats.lines);
+  MI_CPPTEST_CHECK_EQ(configfile.str().size(), stats.bytes);
+  MI_CPPTEST_CHECK_EQ(2, stats.values);
+  MI_CPPTEST_CHECK_EQ(2, stats.lookups);
+
+  std::vector<std::string> positional;
+  parse_command_line({"--pair", "a", "b", "input"}, options, positional);
+  MI_CPPTEST_CHECK_EQ(4, stats.arguments);
+  MI_CPPTEST_CHECK_EQ(4, stats.values);
+  MI_CPPTEST_CHECK_EQ(3, stats.lookups);
+  MI_CPPTEST_CHECK_EQ(0, stats.lookup_misses);
+
+  MI_CPPTEST_CHECK_THROW(options.find_option("nothing"), option_error);
+  MI_CPPTEST_CHECK_EQ(1, stats.lookup_misses);
+
+  std::ostringstream out;
+  options.dump_stats(out);
+  MI_CPPTEST_CHECK(out.str().find("lookups: 4 (1 misses)\n") != std::string::npos);
+
+  options.set_stats(nullptr);
+  options.find_option("pair");
+  MI_CPPTEST_CHECK_EQ(4, stats.lookups);
+
+  // no newline after the last line
+  parse_stats unterminated;
+  options.set_stats(&unterminated);
+  std::istringstream lastline("[one]\nsetting=x");
+  parse_config_file(lastline, options);
+  MI_CPPTEST_CHECK_EQ(2, unterminated.lines);
+  MI_CPPTEST_CHECK_EQ(lastline.str().size(), unterminated.bytes);
+}
+
+MI_CPPTEST_TEST_CASE(progopt_help_columns)
+{
+  const option o1 = option("one.setting", "this is a setting with a long help text").set_shortkey("os");
+  const option o2 = option("two", "short").set_default_value("2");
+  const option o3("a.very.long.option.key.that.does.not.fit", "below");
+  const option o4("silent", "");
+
+  option_set options;
+  options << o1 << o2 << o3 << o4;
+
+  std::ostringstream help;
+  options.help(help, 44);
+  MI_CPPTEST_CHECK_EQ("  --one.setting / -os  this is a setting\n"
+                      "                       with a long help text\n"
+                      "  --two                short (default: 2)\n"
+                      "  --a.very.long.option.key.that.does.not.fit\n"
+                      "                       below\n"
+                      "  --silent\n",
+                      help.str());
+
+  MI_CPPTEST_CHECK(terminal_width() > 0);
+}
+
+MI_CPPTEST_TEST_CASE(progopt_response_files)
+{
+  const option o1 = option("one.setting", "this is a setting").set_composing();
+  const option o2 = option("pair", "two values").set_narg(2);
+
+  option_set options;
+  options << o1 << o2;
+
+  const std::string outer = "test_programoptions_outer.rsp", inner = "test_programoptions_inner.rsp";
+  {
+    std::ofstream out(outer);
+    out << "--one.setting 'single quoted' --one.setting \"double \\\"quoted\\\"\"\n@" << inner << " b\n";
+  }
+  {
+    std::ofstream out(inner);
+    out << "--pair a\n";
+  }
+
+  std::vector<std::string> positional;
+  parse_command_line({"@" + outer}, options, positional);
+  MI_CPPTEST_CHECK_EQ(1, positional.size());
+  MI_CPPTEST_CHECK_EQ("@" + outer, positional.at(0));
+
+  options.set_response_files(true);
+  positional.clear();
+  const value_set values = parse_command_line({"--one.setting", "x", "@" + outer, "@", "input"}, options, positional);
+  MI_CPPTEST_CHECK_EQ(3, values.values(o1).size());
+  MI_CPPTEST_CHECK_EQ("single quoted", values.values(o1).at(1));
+  MI_CPPTEST_CHECK_EQ("double \"quoted\"", values.values(o1).at(2));
+  MI_CPPTEST_CHECK_EQ(2, values.values(o2).size());
+  MI_CPPTEST_CHECK_EQ("b", values.values(o2).at(1));
+  MI_CPPTEST_CHECK_EQ(2, positional.size());
+  MI_CPPTEST_CHECK_EQ("@", positional.at(0));
+
+  {
+    std::ofstream out(inner);
+    out << "--pair a @" << outer << "\n";
+  }
+  MI_CPPTEST_CHECK_THROW(parse_command_line({"@" + outer}, options, positional), option_error);
+  {
+    std::ofstream out(inner);
+    out << "'unterminated\n";
+  }
+  MI_CPPTEST_CHECK_THROW(parse_command_line({"@" + outer}, options, positional), option_error);
+  MI_CPPTEST_CHECK_THROW(parse_command_line({"@test_programoptions_missing.rsp"}, options, positional), option_error);
+
+  // quoted tokens are recycled once an argument and its values are used
+  {
+    std::ofstream out(outer);
+    out << "\"pos 1\" --pair \"a b\" 'c d' \"pos 2\" 'pos 3'\n";
+  }
+  positional.clear();
+  const value_set quoted = parse_command_line({"@" + outer}, options, positional);
+  MI_CPPTEST_CHECK_EQ("a b", quoted.value(o2, 0));
+  MI_CPPTEST_CHECK_EQ("c d", quoted.value(o2, 1));
+  MI_CPPTEST_CHECK_EQ(3, positional.size());
+  MI_CPPTEST_CHECK_EQ("pos 1", positional.at(0));
+  MI_CPPTEST_CHECK_EQ("pos 3", positional.at(2));
+
+  const char* const argv[] = {"test.exe", "@test_programoptions_outer.rsp"};
+  std::vector<const char*> c_positional;
+  MI_CPPTEST_CHECK_THROW(parse_command_line(2, argv, options, c_positional), option_error);
+
+  std::remove(outer.c_str());
+  std::remove(inner.c_str());
+}